@@ -17,6 +17,17 @@ namespace po_style = boost::program_options::command_line_style;
 struct CmdlineOptions {
   bool isVerboseOutputEnabled;
   bool isWithoutProgressBar;
+  // Number of planets evaluated before the metric is extrapolated to the
+  // whole route (0 evaluates the whole route)
+  int numberOfSampledPlanets;
+  // Configuration of the spaceship computer ("original", "tage", "tage-4way"
+  // or "tage-8way")
+  std::string spaceshipComputer;
+  // Directory caching the predictions of the spaceship computer per route
+  // (empty disables the cache)
+  std::string spaceshipCacheDir;
+  // Count the spaceship computer in its own counter bank
+  bool isSpaceshipComputerMeasured;
   std::string inFile;
 };
 
@@ -42,6 +53,30 @@ bool parseComdlineOptions(int argc, char **argv, CmdlineOptions &cmdline_opts) {
       "without-progress-bar,p",
       po::bool_switch(&cmdline_opts.isWithoutProgressBar)->default_value(false),
       "disable evaluation progress bar");
+  parameters.add_options()(
+      "sample-planets,s",
+      po::value<int>(&cmdline_opts.numberOfSampledPlanets)->default_value(0),
+      "evaluate only the first N planets and extrapolate the metric of "
+      "computational cost to the whole route");
+  parameters.add_options()(
+      "spaceship-computer",
+      po::value<std::string>(&cmdline_opts.spaceshipComputer)
+          ->default_value("original"),
+      "configuration of the spaceship computer: original (the one of the "
+      "challenge), tage (a stronger reference predictor), tage-4way or "
+      "tage-8way (the same with set-associative tables)");
+  parameters.add_options()(
+      "spaceship-cache",
+      po::value<std::string>(&cmdline_opts.spaceshipCacheDir)
+          ->default_value(""),
+      "directory where the predictions of the spaceship computer are cached "
+      "per route, so repeated evaluations of a route don't recompute them");
+  parameters.add_options()(
+      "measure-spaceship-computer",
+      po::bool_switch(&cmdline_opts.isSpaceshipComputerMeasured)
+          ->default_value(false),
+      "report the cost of the spaceship computer in its own counter bank "
+      "(it is never part of the metric)");
   option_desc.add(generic).add(input).add(parameters);
 
   // Read the command-line options
@@ -68,6 +103,15 @@ bool parseComdlineOptions(int argc, char **argv, CmdlineOptions &cmdline_opts) {
     return false;
   }
 
+  if (cmdline_opts.spaceshipComputer != "original" &&
+      cmdline_opts.spaceshipComputer != "tage" &&
+      cmdline_opts.spaceshipComputer != "tage-4way" &&
+      cmdline_opts.spaceshipComputer != "tage-8way") {
+    std::cerr << "Error: unknown spaceship computer configuration "
+              << cmdline_opts.spaceshipComputer << std::endl;
+    return false;
+  }
+
   return true;
 }
 
@@ -0,0 +1,725 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// LLVM pass plugin that instruments every basic block with counters of
+// additive, multiplicative and bitwise instructions. The counters are only
+// advanced while isDynamicInstructionCountingEnabled is set to 1 (see
+// DynamicInstructionCounting_API.hpp).
+//
+// Optional features are selected at compile time with environment variables:
+//   DYN_INSTR_COUNT_PER_BLOCK=1  give every instrumented basic block its own
+//                                counters keyed by function and debug location
+//   DYN_INSTR_COUNT_FAST_PATH=1  run uninstrumented copies of the functions
+//                                while counting is disabled
+//   DYN_INSTR_COUNT_OPCODES=1    also count every instruction by LLVM opcode
+//                                (weighted by the cost table of the API)
+//   DYN_INSTR_COUNT_MEMORY=1     report loads and stores to the API to build
+//                                the cache-line footprint of RoboMemory
+//   DYN_INSTR_COUNT_VECTOR=1     also count vector operations and intrinsic
+//                                calls per instruction and per lane
+//   DYN_INSTR_COUNT_WORST_CASE=1 print a static upper bound of the cost of a
+//                                call of the Robo predictor entry points (see
+//                                WorstCaseCostAnalysis.hpp)
+//
+// The counted instructions of every source line are reported as optimization
+// remarks of the "dynamic-instruction-counting" pass, e.g. with
+// -Rpass=dynamic-instruction-counting or -fsave-optimization-record.
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "InstructionCategories.hpp"
+#include "WorstCaseCostAnalysis.hpp"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Demangle/Demangle.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Pass.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+
+using namespace llvm;
+
+namespace {
+
+// Functions from the runtime that must never be instrumented
+const char *const kSkippedFunctions[] = {
+    "__atomic_compare_exchange", "__atomic_is_lock_free", "libc_exit_fini",
+    "__init_libc", "recordMemoryAccess"};
+
+// Name of the pass in optimization remarks
+const char *const kRemarkPassName = "dynamic-instruction-counting";
+
+// Functions of the counting API that switch counting on and off
+const char *const kCountingSwitchFunctions[] = {
+    "enableDynamicInstructionCounting", "disableDynamicInstructionCounting"};
+
+// Size of opcodeInstructionCounter in DynamicInstructionCounting_API.hpp
+const unsigned kMaxOpcodeCounters = 128;
+
+// Rows of vectorOperationCounter in DynamicInstructionCounting_API.hpp, each
+// with one counter per instruction category
+enum VectorCounterKind {
+  VECTOR_INSTRUCTIONS,
+  VECTOR_LANES,
+  INTRINSIC_CALLS,
+  INTRINSIC_LANES,
+  NUM_VECTOR_COUNTER_KINDS
+};
+
+bool isEnvOptionEnabled(const char *name) {
+  const char *value = std::getenv(name);
+  return value && std::strcmp(value, "0") != 0;
+}
+
+bool isSkippedFunction(const Function &F) {
+  for (const char *name : kSkippedFunctions) {
+    if (F.getName() == name) return true;
+  }
+  return false;
+}
+
+struct DynamicInstructionCounter : public ModulePass {
+  static char ID;
+  DynamicInstructionCounter() : ModulePass(ID) {
+    isPerBlockCountingEnabled = isEnvOptionEnabled("DYN_INSTR_COUNT_PER_BLOCK");
+    isFastPathEnabled = isEnvOptionEnabled("DYN_INSTR_COUNT_FAST_PATH");
+    isOpcodeCountingEnabled = isEnvOptionEnabled("DYN_INSTR_COUNT_OPCODES");
+    isMemoryTracingEnabled = isEnvOptionEnabled("DYN_INSTR_COUNT_MEMORY");
+    isVectorAccountingEnabled = isEnvOptionEnabled("DYN_INSTR_COUNT_VECTOR");
+  }
+
+  bool runOnModule(Module &M) override {
+    bool modified = false;
+    if (isMemoryTracingEnabled) {
+      // Before cloning, so that the uninstrumented copies register it too
+      modified |= addTrackedRegionRegistration(M);
+    }
+    if (isFastPathEnabled) {
+      createUninstrumentedClones(M);
+    }
+    for (Function &F : M) {
+      if (uninstrumentedClones.count(&F)) continue;
+      modified |= runOnFunction(F, M);
+    }
+    if (isFastPathEnabled) {
+      for (auto &entry : clonedFunctions) {
+        addFastPathDispatch(*entry.first, *entry.second, M);
+      }
+    }
+    if (isPerBlockCountingEnabled && !blockRecords.empty()) {
+      emitBasicBlockCostRecords(M);
+    }
+    if (isOpcodeCountingEnabled && !countedOpcodes.empty()) {
+      emitOpcodeNameRegistration(M);
+    }
+    return modified;
+  }
+
+  bool runOnFunction(Function &F, Module &M) {
+    if (isSkippedFunction(F)) return false;
+    emitCostRemarks(F);
+    bool modified = false;
+    for (BasicBlock &BB : F) {
+      modified |= runOnBasicBlock(BB, M);
+    }
+    return modified;
+  }
+
+  bool runOnBasicBlock(BasicBlock &BB, Module &M) {
+    Type *int64Ty = Type::getInt64Ty(M.getContext());
+    Constant *counters[] = {
+        M.getOrInsertGlobal("additiveInstructionCounter", int64Ty),
+        M.getOrInsertGlobal("multiplicativeInstructionCounter", int64Ty),
+        M.getOrInsertGlobal("bitwiseInstructionCounter", int64Ty)};
+
+    int numInstructions[NOT_COUNTED] = {0, 0, 0};
+    for (Instruction &I : BB) {
+      InstructionCategory category = classifyInstruction(I);
+      if (category != NOT_COUNTED) numInstructions[category]++;
+    }
+    std::vector<Instruction *> memoryAccesses;
+    if (isMemoryTracingEnabled) {
+      for (Instruction &I : BB) {
+        if (isa<LoadInst>(I) || isa<StoreInst>(I) || isa<AtomicRMWInst>(I) ||
+            isa<AtomicCmpXchgInst>(I) || isa<MemIntrinsic>(I)) {
+          memoryAccesses.push_back(&I);
+        }
+      }
+    }
+    bool modified = isOpcodeCountingEnabled && addOpcodeCounters(BB, M);
+    modified |= isVectorAccountingEnabled && addVectorCounters(BB, M);
+    for (Instruction *I : memoryAccesses) {
+      modified |= addMemoryAccessHooks(*I, M);
+    }
+    if (numInstructions[ADDITIVE] + numInstructions[MULTIPLICATIVE] +
+            numInstructions[BITWISE] <=
+        0) {
+      return modified;
+    }
+
+    // counter += isDynamicInstructionCountingEnabled * <static count>
+    Constant *flag =
+        M.getOrInsertGlobal("isDynamicInstructionCountingEnabled", int64Ty);
+    Instruction *terminator = BB.getTerminator();
+    LoadInst *flagValue = new LoadInst(int64Ty, flag, flag->getName() + ".val",
+                                       terminator);
+    std::vector<Value *> increments(NOT_COUNTED, nullptr);
+    for (int category = ADDITIVE; category < NOT_COUNTED; category++) {
+      if (numInstructions[category] == 0) continue;
+      increments[category] = BinaryOperator::CreateMul(
+          flagValue, ConstantInt::get(int64Ty, numInstructions[category]), "",
+          terminator);
+      new AtomicRMWInst(AtomicRMWInst::Add, counters[category],
+                        increments[category], Align(),
+                        AtomicOrdering::SequentiallyConsistent, SyncScope::System,
+                        terminator);
+    }
+
+    if (isPerBlockCountingEnabled) {
+      addBasicBlockCostRecord(BB, increments);
+    }
+    return true;
+  }
+
+ private:
+  // Optimization remarks. One remark per source line of the function lists the
+  // instructions of the line charged by the counters (the static counts, i.e.
+  // per execution of the line) and their cost. Remarks are only built when
+  // they are requested on the command line.
+  struct LineCost {
+    DebugLoc location;
+    const BasicBlock *block = nullptr;
+    uint64_t numInstructions[NOT_COUNTED] = {0, 0, 0};
+  };
+
+  void emitCostRemarks(Function &F) {
+    OptimizationRemarkEmitter ORE(&F);
+    if (!ORE.enabled()) return;
+    MapVector<std::pair<StringRef, unsigned>, LineCost> lines;
+    for (BasicBlock &BB : F) {
+      for (Instruction &I : BB) {
+        InstructionCategory category = classifyInstruction(I);
+        if (category == NOT_COUNTED) continue;
+        const DebugLoc &location = I.getDebugLoc();
+        LineCost &line = lines[location
+                                   ? std::make_pair(location->getFilename(),
+                                                    location->getLine())
+                                   : std::make_pair(StringRef(), 0u)];
+        if (!line.block) {
+          line.location = location;
+          line.block = &BB;
+        }
+        line.numInstructions[category]++;
+      }
+    }
+    for (auto &entry : lines) {
+      const LineCost &line = entry.second;
+      int64_t cost = 0;
+      for (int category = ADDITIVE; category < NOT_COUNTED; category++) {
+        cost += line.numInstructions[category] *
+                kInstructionCategoryCost[category];
+      }
+      ORE.emit([&]() {
+        return OptimizationRemark(kRemarkPassName, "InstrumentedCost",
+                                  line.location, line.block)
+               << "counted "
+               << ore::NV("Additive", line.numInstructions[ADDITIVE])
+               << " additive, "
+               << ore::NV("Multiplicative",
+                          line.numInstructions[MULTIPLICATIVE])
+               << " multiplicative and "
+               << ore::NV("Bitwise", line.numInstructions[BITWISE])
+               << " bitwise instructions, cost " << ore::NV("Cost", cost)
+               << " per execution";
+      });
+    }
+  }
+
+  // Per-opcode counters (DYN_INSTR_COUNT_OPCODES). Every instruction of the
+  // block except PHI nodes and debug intrinsics is counted under its opcode in
+  // opcodeInstructionCounter. The names of the counted opcodes are registered
+  // with the counting API by a constructor of the module.
+  bool isOpcodeCountingEnabled = false;
+  std::map<unsigned, std::string> countedOpcodes;
+
+  bool addOpcodeCounters(BasicBlock &BB, Module &M) {
+    std::map<unsigned, uint64_t> numInstructions;
+    for (Instruction &I : BB) {
+      if (isa<PHINode>(I) || isa<DbgInfoIntrinsic>(I)) continue;
+      if (I.getOpcode() >= kMaxOpcodeCounters) continue;
+      numInstructions[I.getOpcode()]++;
+      countedOpcodes[I.getOpcode()] = I.getOpcodeName();
+    }
+    return addCounterArrayIncrements(BB, M, "opcodeInstructionCounter",
+                                     kMaxOpcodeCounters, numInstructions);
+  }
+
+  // counters[index] += isDynamicInstructionCountingEnabled * count for every
+  // (index, count) pair, with plain (non-atomic) read-modify-writes
+  bool addCounterArrayIncrements(BasicBlock &BB, Module &M, StringRef name,
+                                 unsigned size,
+                                 const std::map<unsigned, uint64_t> &counts) {
+    if (counts.empty()) return false;
+    IRBuilder<> builder(BB.getTerminator());
+    Type *int64Ty = builder.getInt64Ty();
+    ArrayType *countersTy = ArrayType::get(int64Ty, size);
+    Constant *counters = M.getOrInsertGlobal(name, countersTy);
+    Constant *flag =
+        M.getOrInsertGlobal("isDynamicInstructionCountingEnabled", int64Ty);
+    Value *flagValue =
+        builder.CreateLoad(int64Ty, flag, flag->getName() + ".val");
+    for (auto &entry : counts) {
+      Value *counter = builder.CreateInBoundsGEP(
+          countersTy, counters,
+          {builder.getInt64(0), builder.getInt64(entry.first)});
+      Value *oldValue = builder.CreateLoad(int64Ty, counter);
+      Value *increment =
+          builder.CreateMul(flagValue, builder.getInt64(entry.second));
+      builder.CreateStore(builder.CreateAdd(oldValue, increment), counter);
+    }
+    return true;
+  }
+
+  // Vector operations and intrinsics (DYN_INSTR_COUNT_VECTOR). The official
+  // metric charges a vector binary operator like a scalar one, whatever its
+  // number of lanes, and never charges intrinsic calls. Both are counted here
+  // per instruction and per lane in vectorOperationCounter, so that the API
+  // can report them separately and compute a metric charged per lane.
+  bool isVectorAccountingEnabled = false;
+
+  bool addVectorCounters(BasicBlock &BB, Module &M) {
+    std::map<unsigned, uint64_t> counts;
+    for (Instruction &I : BB) {
+      VectorCounterKind kind;
+      InstructionCategory category;
+      unsigned numLanes;
+      if (auto *II = dyn_cast<IntrinsicInst>(&I)) {
+        category = classifyIntrinsic(*II);
+        kind = INTRINSIC_CALLS;
+        numLanes = getNumLanes(*II);
+      } else if (I.getType()->isVectorTy()) {
+        category = classifyInstruction(I);
+        kind = VECTOR_INSTRUCTIONS;
+        numLanes = getNumLanes(I.getType());
+      } else {
+        continue;
+      }
+      if (category == NOT_COUNTED) continue;
+      counts[kind * NOT_COUNTED + category]++;
+      counts[(kind + 1) * NOT_COUNTED + category] += numLanes;
+    }
+    return addCounterArrayIncrements(BB, M, "vectorOperationCounter",
+                                     NUM_VECTOR_COUNTER_KINDS * NOT_COUNTED,
+                                     counts);
+  }
+
+  // Emit a constructor calling registerOpcodeName() from the counting API for
+  // every opcode counted in this module
+  void emitOpcodeNameRegistration(Module &M) {
+    LLVMContext &C = M.getContext();
+    IRBuilder<> builder(C);
+    FunctionCallee registerFn =
+        M.getOrInsertFunction("registerOpcodeName", builder.getVoidTy(),
+                              builder.getInt64Ty(), builder.getInt8PtrTy());
+    Function *ctor = Function::Create(
+        FunctionType::get(builder.getVoidTy(), false),
+        GlobalValue::InternalLinkage, "__dic_register_opcodes", M);
+    builder.SetInsertPoint(BasicBlock::Create(C, "entry", ctor));
+    for (auto &entry : countedOpcodes) {
+      builder.CreateCall(registerFn, {builder.getInt64(entry.first),
+                                      getStringConstant(M, entry.second)});
+    }
+    builder.CreateRetVoid();
+    appendToGlobalCtors(M, ctor, 65535);
+  }
+
+  // RoboMemory footprint (DYN_INSTR_COUNT_MEMORY). The allocation made by
+  // operator new in the RoboPredictor constructor is registered with
+  // registerTrackedMemoryRegion(), and every load, store, atomic and memory
+  // intrinsic of the original code calls recordMemoryAccess() of the counting
+  // API beforehand. The API filters the accesses by address and by the flag.
+  bool isMemoryTracingEnabled = false;
+
+  bool addTrackedRegionRegistration(Module &M) {
+    bool modified = false;
+    for (Function &F : M) {
+      if (demangle(F.getName().str()).rfind("RoboPredictor::RoboPredictor(",
+                                            0) != 0) {
+        continue;
+      }
+      for (Instruction &I : instructions(F)) {
+        auto *call = dyn_cast<CallBase>(&I);
+        Function *callee = call ? call->getCalledFunction() : nullptr;
+        if (!callee || call->arg_size() == 0 ||
+            demangle(callee->getName().str()).rfind("operator new", 0) != 0) {
+          continue;
+        }
+        Instruction *insertPoint = call->getNextNode();
+        if (auto *invoke = dyn_cast<InvokeInst>(call)) {
+          insertPoint = &*invoke->getNormalDest()->getFirstInsertionPt();
+        }
+        IRBuilder<> builder(insertPoint);
+        FunctionCallee registerFn = M.getOrInsertFunction(
+            "registerTrackedMemoryRegion", builder.getVoidTy(),
+            builder.getInt8PtrTy(), builder.getInt64Ty());
+        builder.CreateCall(
+            registerFn,
+            {builder.CreatePointerCast(call, builder.getInt8PtrTy()),
+             builder.CreateZExtOrTrunc(call->getArgOperand(0),
+                                       builder.getInt64Ty())});
+        modified = true;
+      }
+    }
+    return modified;
+  }
+
+  bool addMemoryAccessHooks(Instruction &I, Module &M) {
+    IRBuilder<> builder(&I);
+    const DataLayout &DL = M.getDataLayout();
+    auto addHook = [&](Value *address, Value *size, bool isStore) {
+      if (address->getType()->getPointerAddressSpace() != 0) return false;
+      FunctionCallee hook = M.getOrInsertFunction(
+          "recordMemoryAccess", builder.getVoidTy(), builder.getInt8PtrTy(),
+          builder.getInt64Ty(), builder.getInt64Ty());
+      builder.CreateCall(
+          hook, {builder.CreatePointerCast(address, builder.getInt8PtrTy()),
+                 builder.CreateZExtOrTrunc(size, builder.getInt64Ty()),
+                 builder.getInt64(isStore)});
+      return true;
+    };
+    auto getSize = [&](Type *type) {
+      return builder.getInt64(DL.getTypeStoreSize(type).getFixedValue());
+    };
+    if (auto *load = dyn_cast<LoadInst>(&I)) {
+      return addHook(load->getPointerOperand(), getSize(load->getType()),
+                     false);
+    }
+    if (auto *store = dyn_cast<StoreInst>(&I)) {
+      return addHook(store->getPointerOperand(),
+                     getSize(store->getValueOperand()->getType()), true);
+    }
+    if (auto *rmw = dyn_cast<AtomicRMWInst>(&I)) {
+      return addHook(rmw->getPointerOperand(),
+                     getSize(rmw->getValOperand()->getType()), true);
+    }
+    if (auto *cmpxchg = dyn_cast<AtomicCmpXchgInst>(&I)) {
+      return addHook(cmpxchg->getPointerOperand(),
+                     getSize(cmpxchg->getNewValOperand()->getType()), true);
+    }
+    auto *memIntrinsic = cast<MemIntrinsic>(&I);
+    bool modified = false;
+    if (auto *transfer = dyn_cast<MemTransferInst>(memIntrinsic)) {
+      modified |= addHook(transfer->getRawSource(), transfer->getLength(),
+                          false);
+    }
+    modified |= addHook(memIntrinsic->getRawDest(), memIntrinsic->getLength(),
+                        true);
+    return modified;
+  }
+
+  // Uninstrumented clones (DYN_INSTR_COUNT_FAST_PATH). Every instrumented
+  // function gets an uninstrumented copy, and its entry block jumps to the
+  // copy while counting is disabled. Calls made from the copies go straight to
+  // the copies of their callees, so code outside of the counting window runs
+  // without instrumentation. Functions that may be on the stack when counting
+  // is switched on or off (callers of enable/disableDynamicInstructionCounting
+  // in this module) are not cloned, which keeps counting in the window exact.
+  bool isFastPathEnabled = false;
+  MapVector<Function *, Function *> clonedFunctions;
+  SmallPtrSet<Function *, 32> uninstrumentedClones;
+
+  // Functions that switch counting on or off, directly or through calls
+  SmallPtrSet<Function *, 8> getCountingSwitchFunctions(Module &M) {
+    SmallVector<Function *, 8> worklist;
+    for (Function &F : M) {
+      std::string name = demangle(F.getName().str());
+      for (const char *switchName : kCountingSwitchFunctions) {
+        if (StringRef(name).startswith(switchName)) worklist.push_back(&F);
+      }
+    }
+    if (GlobalVariable *flag =
+            M.getGlobalVariable("isDynamicInstructionCountingEnabled")) {
+      for (User *user : flag->users()) {
+        if (auto *store = dyn_cast<StoreInst>(user)) {
+          worklist.push_back(store->getFunction());
+        }
+      }
+    }
+    SmallPtrSet<Function *, 8> switchFunctions;
+    while (!worklist.empty()) {
+      Function *F = worklist.pop_back_val();
+      if (!switchFunctions.insert(F).second) continue;
+      for (User *user : F->users()) {
+        auto *call = dyn_cast<CallBase>(user);
+        if (call && call->getCalledFunction() == F) {
+          worklist.push_back(call->getFunction());
+        }
+      }
+    }
+    return switchFunctions;
+  }
+
+  bool isWorthCloning(const Function &F) {
+    for (const Instruction &I : instructions(F)) {
+      if (classifyInstruction(I) != NOT_COUNTED) return true;
+      if (isa<CallBase>(I) && !isa<IntrinsicInst>(I)) return true;
+    }
+    return false;
+  }
+
+  bool canBeCloned(const Function &F) {
+    if (F.isDeclaration() || F.isVarArg() || isSkippedFunction(F) ||
+        F.hasFnAttribute(Attribute::Naked) ||
+        F.callsFunctionThatReturnsTwice()) {
+      return false;
+    }
+    for (const Argument &arg : F.args()) {
+      if (arg.hasInAllocaAttr() || arg.hasPreallocatedAttr()) return false;
+    }
+    return true;
+  }
+
+  void createUninstrumentedClones(Module &M) {
+    SmallPtrSet<Function *, 8> switchFunctions = getCountingSwitchFunctions(M);
+    std::vector<Function *> functions;
+    for (Function &F : M) {
+      if (!switchFunctions.count(&F) && canBeCloned(F) && isWorthCloning(F)) {
+        functions.push_back(&F);
+      }
+    }
+    for (Function *F : functions) {
+      ValueToValueMapTy VMap;
+      Function *clone = CloneFunction(F, VMap);
+      clone->setName(F->getName() + ".uninstrumented");
+      clone->setLinkage(GlobalValue::InternalLinkage);
+      clone->setVisibility(GlobalValue::DefaultVisibility);
+      clone->setComdat(nullptr);
+      clonedFunctions[F] = clone;
+      uninstrumentedClones.insert(clone);
+    }
+    for (Function *clone : uninstrumentedClones) {
+      for (Instruction &I : instructions(*clone)) {
+        auto *call = dyn_cast<CallBase>(&I);
+        if (!call) continue;
+        auto cloned = clonedFunctions.find(call->getCalledFunction());
+        if (cloned != clonedFunctions.end()) {
+          call->setCalledFunction(cloned->second);
+        }
+      }
+    }
+  }
+
+  // Insert a new entry block calling the uninstrumented clone while
+  // isDynamicInstructionCountingEnabled is 0
+  void addFastPathDispatch(Function &F, Function &clone, Module &M) {
+    LLVMContext &C = M.getContext();
+    BasicBlock *oldEntry = &F.getEntryBlock();
+    BasicBlock *dispatch = BasicBlock::Create(C, "dic.dispatch", &F, oldEntry);
+    BasicBlock *fastPath = BasicBlock::Create(C, "dic.uninstrumented", &F,
+                                              oldEntry);
+
+    // Static allocas must stay in the entry block to be promoted later
+    for (Instruction &I : make_early_inc_range(*oldEntry)) {
+      auto *alloca = dyn_cast<AllocaInst>(&I);
+      if (alloca && isa<Constant>(alloca->getArraySize())) {
+        alloca->moveBefore(*dispatch, dispatch->end());
+      }
+    }
+
+    IRBuilder<> builder(dispatch);
+    Constant *flag = M.getOrInsertGlobal("isDynamicInstructionCountingEnabled",
+                                         builder.getInt64Ty());
+    Value *flagValue =
+        builder.CreateLoad(builder.getInt64Ty(), flag, "dic.enabled");
+    builder.CreateCondBr(builder.CreateICmpEQ(flagValue, builder.getInt64(0)),
+                         fastPath, oldEntry);
+
+    builder.SetInsertPoint(fastPath);
+    if (DISubprogram *subprogram = F.getSubprogram()) {
+      builder.SetCurrentDebugLocation(
+          DILocation::get(C, subprogram->getLine(), 0, subprogram));
+    }
+    SmallVector<Value *, 8> args;
+    for (Argument &arg : F.args()) args.push_back(&arg);
+    CallInst *call = builder.CreateCall(&clone, args);
+    call->setCallingConv(clone.getCallingConv());
+    call->setAttributes(clone.getAttributes());
+    if (F.getReturnType()->isVoidTy()) {
+      builder.CreateRetVoid();
+    } else {
+      builder.CreateRet(call);
+    }
+  }
+
+  // Per-block counters (DYN_INSTR_COUNT_PER_BLOCK)
+  struct BlockRecord {
+    std::string functionName;
+    std::string fileName;
+    unsigned line;
+  };
+
+  bool isPerBlockCountingEnabled = false;
+  std::vector<BlockRecord> blockRecords;
+  GlobalVariable *blockRecordTable = nullptr;
+  StringMap<Constant *> stringConstants;
+
+  // The layout must match BasicBlockCostRecord in
+  // DynamicInstructionCounting_API.hpp
+  StructType *getBlockRecordType(LLVMContext &C) {
+    Type *ptrTy = Type::getInt8PtrTy(C);
+    Type *int64Ty = Type::getInt64Ty(C);
+    return StructType::get(C, {ptrTy, ptrTy, int64Ty, int64Ty, int64Ty, int64Ty});
+  }
+
+  // The record table is created with a placeholder type while the module is
+  // being instrumented, and replaced with the final array once the number of
+  // blocks is known
+  GlobalVariable *getBlockRecordTable(Module &M) {
+    if (!blockRecordTable) {
+      blockRecordTable = new GlobalVariable(
+          M, getBlockRecordType(M.getContext()), false,
+          GlobalValue::PrivateLinkage, nullptr, "__dic_bb_records.tmp");
+    }
+    return blockRecordTable;
+  }
+
+  void addBasicBlockCostRecord(BasicBlock &BB,
+                               const std::vector<Value *> &increments) {
+    Function &F = *BB.getParent();
+    Module &M = *F.getParent();
+    BlockRecord record{demangle(F.getName().str()), "??", 0};
+    for (Instruction &I : BB) {
+      if (const DILocation *loc = I.getDebugLoc()) {
+        record.fileName = loc->getFilename().str();
+        record.line = loc->getLine();
+        break;
+      }
+    }
+    uint64_t recordIndex = blockRecords.size();
+    blockRecords.push_back(record);
+
+    // Plain (non-atomic) read-modify-write of the counters of this block
+    IRBuilder<> builder(BB.getTerminator());
+    Type *int64Ty = builder.getInt64Ty();
+    GlobalVariable *table = getBlockRecordTable(M);
+    for (int category = ADDITIVE; category < NOT_COUNTED; category++) {
+      if (!increments[category]) continue;
+      Value *counter = builder.CreateInBoundsGEP(
+          getBlockRecordType(M.getContext()), table,
+          {builder.getInt64(recordIndex), builder.getInt32(3 + category)});
+      Value *oldValue = builder.CreateLoad(int64Ty, counter);
+      builder.CreateStore(builder.CreateAdd(oldValue, increments[category]),
+                          counter);
+    }
+  }
+
+  // Emit the final record table and a constructor registering it with
+  // registerBasicBlockCostRecords() from the counting API
+  void emitBasicBlockCostRecords(Module &M) {
+    LLVMContext &C = M.getContext();
+    StructType *recordTy = getBlockRecordType(C);
+    ArrayType *tableTy = ArrayType::get(recordTy, blockRecords.size());
+    IRBuilder<> builder(C);
+
+    std::vector<Constant *> initializers;
+    Constant *zero = builder.getInt64(0);
+    for (const BlockRecord &record : blockRecords) {
+      initializers.push_back(ConstantStruct::get(
+          recordTy, {getStringConstant(M, record.functionName),
+                     getStringConstant(M, record.fileName),
+                     builder.getInt64(record.line), zero, zero, zero}));
+    }
+    GlobalVariable *table = new GlobalVariable(
+        M, tableTy, false, GlobalValue::PrivateLinkage,
+        ConstantArray::get(tableTy, initializers), "__dic_bb_records");
+    blockRecordTable->replaceAllUsesWith(
+        ConstantExpr::getBitCast(table, blockRecordTable->getType()));
+    blockRecordTable->eraseFromParent();
+    blockRecordTable = table;
+
+    FunctionCallee registerFn = M.getOrInsertFunction(
+        "registerBasicBlockCostRecords", builder.getVoidTy(),
+        builder.getInt8PtrTy(), builder.getInt64Ty());
+    Function *ctor = Function::Create(
+        FunctionType::get(builder.getVoidTy(), false),
+        GlobalValue::InternalLinkage, "__dic_register_bb_records", M);
+    builder.SetInsertPoint(BasicBlock::Create(C, "entry", ctor));
+    builder.CreateCall(registerFn,
+                       {builder.CreateBitCast(table, builder.getInt8PtrTy()),
+                        builder.getInt64(blockRecords.size())});
+    builder.CreateRetVoid();
+    appendToGlobalCtors(M, ctor, 65535);
+  }
+
+  Constant *getStringConstant(Module &M, const std::string &str) {
+    Constant *&cached = stringConstants[str];
+    if (!cached) {
+      Constant *init = ConstantDataArray::getString(M.getContext(), str);
+      GlobalVariable *var = new GlobalVariable(M, init->getType(), true,
+                                               GlobalValue::PrivateLinkage,
+                                               init, "__dic_str");
+      var->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+      cached = ConstantExpr::getBitCast(var, Type::getInt8PtrTy(M.getContext()));
+    }
+    return cached;
+  }
+};
+
+char DynamicInstructionCounter::ID = 0;
+
+struct MyPass : public PassInfoMixin<MyPass> {
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &) {
+    DynamicInstructionCounter counter;
+    counter.runOnModule(M);
+    return PreservedAnalyses::none();
+  }
+  static bool isRequired() { return true; }
+};
+
+}  // namespace
+
+extern "C" LLVM_ATTRIBUTE_WEAK ::llvm::PassPluginLibraryInfo
+llvmGetPassPluginInfo() {
+  return {LLVM_PLUGIN_API_VERSION, "MyPass", "v0.1", [](PassBuilder &PB) {
+            PB.registerPipelineStartEPCallback(
+                [](ModulePassManager &MPM, OptimizationLevel) {
+                  // The analysis must see the module before instrumentation
+                  if (isEnvOptionEnabled("DYN_INSTR_COUNT_WORST_CASE")) {
+                    MPM.addPass(WorstCaseCostAnalysisPass());
+                  }
+                  MPM.addPass(MyPass());
+                });
+            PB.registerPipelineParsingCallback(
+                [](StringRef name, ModulePassManager &MPM,
+                   ArrayRef<PassBuilder::PipelineElement>) {
+                  if (name == "worst-case-cost") {
+                    MPM.addPass(WorstCaseCostAnalysisPass());
+                    return true;
+                  }
+                  return false;
+                });
+          }};
+}
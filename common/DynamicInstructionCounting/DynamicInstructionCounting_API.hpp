@@ -8,10 +8,11 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-#define ADDITIVE_OP_COST 3
-#define MULTIPLICATIVE_OP_COST 7
-#define BITWISE_OP_COST 1
+#include "DynamicInstructionCounting_Cost.hpp"
+#include "DynamicInstructionCounting_Regions.hpp"
 
 // A flag indicating if instrumentation is enabled or not
 // This flag can only have two values: 0 or 1.
@@ -25,19 +26,1018 @@ int64_t additiveInstructionCounter;
 int64_t multiplicativeInstructionCounter;
 int64_t bitwiseInstructionCounter;
 
+// Counters of every LLVM opcode (indexed by llvm::Instruction::getOpcode()),
+// only advanced with DYN_INSTR_COUNT_OPCODES=1 (see printInstructionMixReport)
+// Must match kMaxOpcodeCounters in DynamicInstructionCounting.cpp
+#define MAX_OPCODE_COUNTERS 128
+int64_t opcodeInstructionCounter[MAX_OPCODE_COUNTERS];
+
+// Counters of vector operations and intrinsic calls per instruction category,
+// only advanced with DYN_INSTR_COUNT_VECTOR=1 (see printVectorOperationReport)
+// The rows must match VectorCounterKind in DynamicInstructionCounting.cpp
+enum VectorCounterKind {
+  VECTOR_INSTRUCTIONS,
+  VECTOR_LANES,
+  INTRINSIC_CALLS,
+  INTRINSIC_LANES,
+  NUM_VECTOR_COUNTER_KINDS
+};
+int64_t vectorOperationCounter[NUM_VECTOR_COUNTER_KINDS][3];
+
+int64_t computeComputationalCost(int64_t additive, int64_t multiplicative,
+                                 int64_t bitwise) {
+  return additive * ADDITIVE_OP_COST + multiplicative * MULTIPLICATIVE_OP_COST +
+         bitwise * BITWISE_OP_COST;
+}
+
+//------------------------------------------------------------------------------
+// Per-call cost distribution
+//
+// The counters are snapshotted when counting is enabled, and the cost of every
+// enabled window (one call of the Robo prediction and update functions in
+// main.cpp) is recorded in log-linear histograms when counting is disabled.
+// Values below 2^COST_HISTOGRAM_SUB_BUCKET_BITS are recorded exactly, larger
+// ones with a relative error below 2^-COST_HISTOGRAM_SUB_BUCKET_BITS.
+
+#define COST_HISTOGRAM_SUB_BUCKET_BITS 6
+#define COST_HISTOGRAM_SUB_BUCKETS (1 << COST_HISTOGRAM_SUB_BUCKET_BITS)
+#define COST_HISTOGRAM_NUM_BUCKETS (64 * COST_HISTOGRAM_SUB_BUCKETS)
+
+struct CostHistogram {
+  int64_t numSamples;
+  int64_t min;
+  int64_t max;
+  int64_t buckets[COST_HISTOGRAM_NUM_BUCKETS];
+};
+
+enum CostHistogramKind {
+  ADDITIVE_COST_HISTOGRAM,
+  MULTIPLICATIVE_COST_HISTOGRAM,
+  BITWISE_COST_HISTOGRAM,
+  METRIC_COST_HISTOGRAM,
+  NUM_COST_HISTOGRAMS
+};
+
+CostHistogram callCostHistograms[NUM_COST_HISTOGRAMS];
+
+// Counter values at the last call of enableDynamicInstructionCounting()
+int64_t additiveInstructionCounterAtEnable;
+int64_t multiplicativeInstructionCounterAtEnable;
+int64_t bitwiseInstructionCounterAtEnable;
+
+int getCostHistogramBucket(int64_t value) {
+  if (value < COST_HISTOGRAM_SUB_BUCKETS) return (int)value;
+  int msb = 63 - __builtin_clzll((uint64_t)value);
+  int shift = msb - COST_HISTOGRAM_SUB_BUCKET_BITS;
+  return COST_HISTOGRAM_SUB_BUCKETS * (shift + 1) +
+         (int)((value >> shift) - COST_HISTOGRAM_SUB_BUCKETS);
+}
+
+// The smallest value recorded in the given bucket
+int64_t getCostHistogramBucketValue(int bucket) {
+  if (bucket < COST_HISTOGRAM_SUB_BUCKETS) return bucket;
+  int shift = bucket / COST_HISTOGRAM_SUB_BUCKETS - 1;
+  int64_t subBucket = bucket % COST_HISTOGRAM_SUB_BUCKETS;
+  return (COST_HISTOGRAM_SUB_BUCKETS + subBucket) << shift;
+}
+
+void recordCostHistogramSample(CostHistogram *histogram, int64_t value) {
+  if (value < 0) value = 0;
+  if (histogram->numSamples == 0 || value < histogram->min) {
+    histogram->min = value;
+  }
+  if (value > histogram->max) histogram->max = value;
+  histogram->numSamples++;
+  histogram->buckets[getCostHistogramBucket(value)]++;
+}
+
+// Value below which the given fraction of samples falls
+int64_t getCostHistogramPercentile(const CostHistogram *histogram,
+                                   double fraction) {
+  int64_t rank = (int64_t)(fraction * histogram->numSamples);
+  if (rank >= histogram->numSamples) rank = histogram->numSamples - 1;
+  int64_t seen = 0;
+  for (int bucket = 0; bucket < COST_HISTOGRAM_NUM_BUCKETS; bucket++) {
+    seen += histogram->buckets[bucket];
+    if (seen > rank) {
+      int64_t value = getCostHistogramBucketValue(bucket);
+      if (value < histogram->min) value = histogram->min;
+      if (value > histogram->max) value = histogram->max;
+      return value;
+    }
+  }
+  return histogram->max;
+}
+
+void recordCallCost() {
+  int64_t additive =
+      additiveInstructionCounter - additiveInstructionCounterAtEnable;
+  int64_t multiplicative = multiplicativeInstructionCounter -
+                           multiplicativeInstructionCounterAtEnable;
+  int64_t bitwise =
+      bitwiseInstructionCounter - bitwiseInstructionCounterAtEnable;
+  recordCostHistogramSample(&callCostHistograms[ADDITIVE_COST_HISTOGRAM],
+                            additive);
+  recordCostHistogramSample(&callCostHistograms[MULTIPLICATIVE_COST_HISTOGRAM],
+                            multiplicative);
+  recordCostHistogramSample(&callCostHistograms[BITWISE_COST_HISTOGRAM],
+                            bitwise);
+  recordCostHistogramSample(
+      &callCostHistograms[METRIC_COST_HISTOGRAM],
+      computeComputationalCost(additive, multiplicative, bitwise));
+}
+
+void printCallCostDistribution() {
+  static const char *const names[NUM_COST_HISTOGRAMS] = {
+      "additive", "multiplicative", "bitwise", "metric"};
+  if (callCostHistograms[METRIC_COST_HISTOGRAM].numSamples == 0) return;
+  printf("Per-call cost distribution (%ld calls):\n",
+         callCostHistograms[METRIC_COST_HISTOGRAM].numSamples);
+  printf("%16s %10s %10s %10s %10s %10s\n", "", "min", "p50", "p99", "p99.9",
+         "max");
+  for (int kind = 0; kind < NUM_COST_HISTOGRAMS; kind++) {
+    const CostHistogram *histogram = &callCostHistograms[kind];
+    printf("%16s %10ld %10ld %10ld %10ld %10ld\n", names[kind], histogram->min,
+           getCostHistogramPercentile(histogram, 0.5),
+           getCostHistogramPercentile(histogram, 0.99),
+           getCostHistogramPercentile(histogram, 0.999), histogram->max);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Named cost regions (see DynamicInstructionCounting_Regions.hpp)
+//
+// Regions form a tree keyed by name and parent. Every region accumulates the
+// counter deltas between its entry and exit, including nested regions.
+
+#define MAX_COST_REGIONS 256
+#define MAX_COST_REGION_DEPTH 64
+
+struct CostRegion {
+  const char *name;
+  int parent;
+  int64_t calls;
+  int64_t additiveInstructionCounter;
+  int64_t multiplicativeInstructionCounter;
+  int64_t bitwiseInstructionCounter;
+};
+
+// Region 0 is the root and stands for everything in the counting window
+CostRegion costRegions[MAX_COST_REGIONS] = {
+    {"counting window", -1, 0, 0, 0, 0}};
+int numCostRegions = 1;
+struct CostRegionEntry {
+  // -1 if the region table overflowed
+  int region;
+  int64_t additiveInstructionCounter;
+  int64_t multiplicativeInstructionCounter;
+  int64_t bitwiseInstructionCounter;
+};
+CostRegionEntry costRegionStack[MAX_COST_REGION_DEPTH];
+int costRegionDepth;
+
+int findOrCreateCostRegion(const char *name, int parent) {
+  for (int region = 1; region < numCostRegions; region++) {
+    if (costRegions[region].parent == parent &&
+        strcmp(costRegions[region].name, name) == 0) {
+      return region;
+    }
+  }
+  if (numCostRegions == MAX_COST_REGIONS) {
+    fprintf(stderr, "Too many cost regions, %s is not profiled\n", name);
+    return -1;
+  }
+  costRegions[numCostRegions].name = name;
+  costRegions[numCostRegions].parent = parent;
+  return numCostRegions++;
+}
+
+// enterCostRegion() and exitCostRegion() switch counting off while updating
+// the regions, so that the bookkeeping is not charged. They are made of a
+// single basic block without counted instructions.
+void enterCostRegionWithCountingDisabled(const char *name) {
+  if (costRegionDepth == MAX_COST_REGION_DEPTH) {
+    fprintf(stderr, "Cost regions are nested too deep\n");
+    exit(1);
+  }
+  int parent = costRegionDepth == 0
+                   ? 0
+                   : costRegionStack[costRegionDepth - 1].region;
+  CostRegionEntry *entry = &costRegionStack[costRegionDepth++];
+  entry->region = parent < 0 ? -1 : findOrCreateCostRegion(name, parent);
+  entry->additiveInstructionCounter = additiveInstructionCounter;
+  entry->multiplicativeInstructionCounter = multiplicativeInstructionCounter;
+  entry->bitwiseInstructionCounter = bitwiseInstructionCounter;
+}
+
+void exitCostRegionWithCountingDisabled() {
+  if (costRegionDepth == 0) return;
+  CostRegionEntry *entry = &costRegionStack[--costRegionDepth];
+  if (entry->region < 0) return;
+  CostRegion *region = &costRegions[entry->region];
+  region->calls++;
+  region->additiveInstructionCounter +=
+      additiveInstructionCounter - entry->additiveInstructionCounter;
+  region->multiplicativeInstructionCounter +=
+      multiplicativeInstructionCounter -
+      entry->multiplicativeInstructionCounter;
+  region->bitwiseInstructionCounter +=
+      bitwiseInstructionCounter - entry->bitwiseInstructionCounter;
+}
+
+void enterCostRegion(const char *name) {
+  int64_t isEnabled = isDynamicInstructionCountingEnabled;
+  isDynamicInstructionCountingEnabled = 0;
+  enterCostRegionWithCountingDisabled(name);
+  isDynamicInstructionCountingEnabled = isEnabled;
+}
+
+void exitCostRegion() {
+  int64_t isEnabled = isDynamicInstructionCountingEnabled;
+  isDynamicInstructionCountingEnabled = 0;
+  exitCostRegionWithCountingDisabled();
+  isDynamicInstructionCountingEnabled = isEnabled;
+}
+
+int64_t getCostRegionCost(const CostRegion *region) {
+  return computeComputationalCost(region->additiveInstructionCounter,
+                                  region->multiplicativeInstructionCounter,
+                                  region->bitwiseInstructionCounter);
+}
+
+void printCostRegion(int region, int depth, int64_t totalCost,
+                     int totalNumberOfPlanets) {
+  int64_t cost = getCostRegionCost(&costRegions[region]);
+  int64_t selfCost = cost;
+  for (int child = 1; child < numCostRegions; child++) {
+    if (costRegions[child].parent == region) {
+      selfCost -= getCostRegionCost(&costRegions[child]);
+    }
+  }
+  printf("%*s%-*s %12ld %14.2f %6.2f%% %14.2f %12.2f\n", 2 * depth, "",
+         32 - 2 * depth, costRegions[region].name, costRegions[region].calls,
+         (double)cost / totalNumberOfPlanets,
+         totalCost > 0 ? 100.0 * cost / totalCost : 0.0,
+         (double)selfCost / totalNumberOfPlanets,
+         costRegions[region].calls > 0
+             ? (double)cost / costRegions[region].calls
+             : 0.0);
+  for (int child = 1; child < numCostRegions; child++) {
+    if (costRegions[child].parent == region) {
+      printCostRegion(child, depth + 1, totalCost, totalNumberOfPlanets);
+    }
+  }
+}
+
+void printCostRegionReport(int totalNumberOfPlanets) {
+  if (numCostRegions == 1) return;
+  CostRegion *root = &costRegions[0];
+  root->calls = callCostHistograms[METRIC_COST_HISTOGRAM].numSamples;
+  root->additiveInstructionCounter = additiveInstructionCounter;
+  root->multiplicativeInstructionCounter = multiplicativeInstructionCounter;
+  root->bitwiseInstructionCounter = bitwiseInstructionCounter;
+  printf("Cost regions:\n");
+  printf("%-32s %12s %14s %7s %14s %12s\n", "region", "calls",
+         "cost/planet", "share", "self/planet", "cost/call");
+  printCostRegion(0, 0, getCostRegionCost(root), totalNumberOfPlanets);
+}
+
+void resetCostRegions() {
+  for (int region = 0; region < numCostRegions; region++) {
+    costRegions[region].calls = 0;
+    costRegions[region].additiveInstructionCounter = 0;
+    costRegions[region].multiplicativeInstructionCounter = 0;
+    costRegions[region].bitwiseInstructionCounter = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+// RoboMemory cache-line footprint (DYN_INSTR_COUNT_MEMORY=1 when building with
+// the development plugin)
+//
+// The pass registers the allocation made by the RoboPredictor constructor
+// (roboMemory_ptr) and reports every load and store executed by instrumented
+// code. Accesses inside the counting window that hit the allocation are
+// attributed to its 64-byte cache lines.
+
+#define MEMORY_FOOTPRINT_LINE_BITS 6
+#define MEMORY_FOOTPRINT_LINE_SIZE (1 << MEMORY_FOOTPRINT_LINE_BITS)
+#define MAX_MEMORY_FOOTPRINT_LINES 4096
+#define DEFAULT_WORKING_SET_INTERVAL 10000
+#define DEFAULT_MEMORY_FOOTPRINT_FILE "robo_memory_lines.csv"
+
+struct MemoryLineStatistics {
+  int64_t loads;
+  int64_t stores;
+  // Number of counting windows that touched the line
+  int64_t calls;
+  // Index of the last window and interval that touched the line
+  int64_t lastCall;
+  int64_t lastInterval;
+};
+
+struct WorkingSetSample {
+  int64_t calls;
+  int64_t intervalLines;
+  int64_t cumulativeLines;
+};
+
+uintptr_t trackedMemoryBegin;
+uintptr_t trackedMemoryEnd;
+int64_t trackedMemorySize;
+uintptr_t trackedMemoryFirstLine;
+MemoryLineStatistics memoryLines[MAX_MEMORY_FOOTPRINT_LINES];
+int64_t numLinesTouchedInCall;
+int64_t numLinesTouchedInInterval;
+int64_t numLinesTouchedEver;
+// Windows and intervals are numbered from 1 so that lastCall == 0 means never
+int64_t memoryFootprintCall = 1;
+int64_t memoryFootprintInterval = 1;
+int64_t workingSetInterval;
+CostHistogram linesPerCallHistogram;
+WorkingSetSample *workingSetSamples;
+int64_t numWorkingSetSamples;
+
+// Called from the RoboPredictor constructor (instrumented by the counting
+// pass) right after RoboMemory is allocated
+extern "C" void registerTrackedMemoryRegion(const void *base, int64_t size) {
+  trackedMemoryBegin = (uintptr_t)base;
+  trackedMemorySize = size;
+  trackedMemoryFirstLine = trackedMemoryBegin >> MEMORY_FOOTPRINT_LINE_BITS;
+  uintptr_t numLines = ((trackedMemoryBegin + size - 1) >>
+                        MEMORY_FOOTPRINT_LINE_BITS) -
+                       trackedMemoryFirstLine + 1;
+  if (numLines > MAX_MEMORY_FOOTPRINT_LINES) {
+    fprintf(stderr, "Only the first %d cache lines of RoboMemory are tracked\n",
+            MAX_MEMORY_FOOTPRINT_LINES);
+    numLines = MAX_MEMORY_FOOTPRINT_LINES;
+  }
+  trackedMemoryEnd = (trackedMemoryFirstLine + numLines)
+                     << MEMORY_FOOTPRINT_LINE_BITS;
+  if (trackedMemoryEnd > trackedMemoryBegin + size) {
+    trackedMemoryEnd = trackedMemoryBegin + size;
+  }
+  const char *intervalEnv = getenv("DYN_INSTR_COUNT_WORKING_SET_INTERVAL");
+  workingSetInterval =
+      intervalEnv ? atol(intervalEnv) : DEFAULT_WORKING_SET_INTERVAL;
+  if (workingSetInterval <= 0) {
+    workingSetInterval = DEFAULT_WORKING_SET_INTERVAL;
+  }
+}
+
+// Called by the pass before every load and store. This function is never
+// instrumented, so it does not change any counter of the metric.
+extern "C" void recordMemoryAccess(const void *address, int64_t size,
+                                   int64_t isStore) {
+  if (!isDynamicInstructionCountingEnabled) return;
+  uintptr_t begin = (uintptr_t)address;
+  uintptr_t end = begin + size;
+  if (begin >= trackedMemoryEnd || end <= trackedMemoryBegin) return;
+  if (begin < trackedMemoryBegin) begin = trackedMemoryBegin;
+  if (end > trackedMemoryEnd) end = trackedMemoryEnd;
+  uintptr_t firstLine = (begin >> MEMORY_FOOTPRINT_LINE_BITS);
+  uintptr_t lastLine = ((end - 1) >> MEMORY_FOOTPRINT_LINE_BITS);
+  for (uintptr_t line = firstLine; line <= lastLine; line++) {
+    MemoryLineStatistics *stats = &memoryLines[line - trackedMemoryFirstLine];
+    if (isStore) {
+      stats->stores++;
+    } else {
+      stats->loads++;
+    }
+    if (stats->lastCall == 0) numLinesTouchedEver++;
+    if (stats->lastCall != memoryFootprintCall) {
+      stats->lastCall = memoryFootprintCall;
+      stats->calls++;
+      numLinesTouchedInCall++;
+    }
+    if (stats->lastInterval != memoryFootprintInterval) {
+      stats->lastInterval = memoryFootprintInterval;
+      numLinesTouchedInInterval++;
+    }
+  }
+}
+
+void recordWorkingSetSample() {
+  if (numWorkingSetSamples % 64 == 0) {
+    WorkingSetSample *samples = (WorkingSetSample *)realloc(
+        workingSetSamples,
+        (numWorkingSetSamples + 64) * sizeof(WorkingSetSample));
+    if (!samples) return;
+    workingSetSamples = samples;
+  }
+  WorkingSetSample *sample = &workingSetSamples[numWorkingSetSamples++];
+  sample->calls = memoryFootprintCall - 1;
+  sample->intervalLines = numLinesTouchedInInterval;
+  sample->cumulativeLines = numLinesTouchedEver;
+  numLinesTouchedInInterval = 0;
+  memoryFootprintInterval++;
+}
+
+void recordMemoryFootprintOfCall() {
+  if (trackedMemorySize == 0) return;
+  recordCostHistogramSample(&linesPerCallHistogram, numLinesTouchedInCall);
+  numLinesTouchedInCall = 0;
+  memoryFootprintCall++;
+  if ((memoryFootprintCall - 1) % workingSetInterval == 0) {
+    recordWorkingSetSample();
+  }
+}
+
+void resetMemoryFootprint() {
+  memset(memoryLines, 0, sizeof(memoryLines));
+  memset(&linesPerCallHistogram, 0, sizeof(linesPerCallHistogram));
+  numLinesTouchedInCall = 0;
+  numLinesTouchedInInterval = 0;
+  numLinesTouchedEver = 0;
+  memoryFootprintCall = 1;
+  memoryFootprintInterval = 1;
+  numWorkingSetSamples = 0;
+}
+
+// Heatmap character of a line: ' ' if the line was never touched, otherwise
+// one of ".:-=+*#%@" on a logarithmic scale up to the hottest line
+char getMemoryLineHeatmapChar(int64_t accesses, int64_t maxAccesses) {
+  static const char levels[] = " .:-=+*#%@";
+  if (accesses == 0) return levels[0];
+  int bits = 64 - __builtin_clzll((uint64_t)accesses);
+  int maxBits = 64 - __builtin_clzll((uint64_t)maxAccesses);
+  if (maxBits == 1) return levels[9];
+  return levels[1 + 8 * (bits - 1) / (maxBits - 1)];
+}
+
+// Print the heatmap of RoboMemory (one character per cache line, 64 lines or
+// 4KiB per row), the distribution of distinct lines touched per call and the
+// working set over time. Per-line statistics are written as CSV to the file
+// named by DYN_INSTR_COUNT_MEMORY_FILE.
+void printMemoryFootprintReport() {
+  if (trackedMemorySize == 0 || linesPerCallHistogram.numSamples == 0) return;
+  if (numLinesTouchedInInterval > 0) recordWorkingSetSample();
+
+  int64_t numLines =
+      ((trackedMemoryEnd - 1) >> MEMORY_FOOTPRINT_LINE_BITS) -
+      trackedMemoryFirstLine + 1;
+  int64_t maxAccesses = 0;
+  for (int64_t i = 0; i < numLines; i++) {
+    int64_t accesses = memoryLines[i].loads + memoryLines[i].stores;
+    if (accesses > maxAccesses) maxAccesses = accesses;
+  }
+  // Offsets are relative to the start of the allocation, so the first line
+  // starts at a negative offset when RoboMemory is not line-aligned
+  int64_t firstLineOffset =
+      -(int64_t)(trackedMemoryBegin & (MEMORY_FOOTPRINT_LINE_SIZE - 1));
+  printf("RoboMemory footprint (%ld bytes in %ld cache lines of %d bytes, "
+         "first line at offset %ld):\n",
+         trackedMemorySize, numLines, MEMORY_FOOTPRINT_LINE_SIZE,
+         firstLineOffset);
+  printf("  lines touched: %ld, never touched: %ld (%ld bytes)\n",
+         numLinesTouchedEver, numLines - numLinesTouchedEver,
+         (numLines - numLinesTouchedEver) * MEMORY_FOOTPRINT_LINE_SIZE);
+  printf("  distinct lines per call: min %ld, p50 %ld, p99 %ld, p99.9 %ld, "
+         "max %ld\n",
+         linesPerCallHistogram.min,
+         getCostHistogramPercentile(&linesPerCallHistogram, 0.5),
+         getCostHistogramPercentile(&linesPerCallHistogram, 0.99),
+         getCostHistogramPercentile(&linesPerCallHistogram, 0.999),
+         linesPerCallHistogram.max);
+  printf("  heatmap (' ' untouched, '.' to '@' from 1 to %ld accesses):\n",
+         maxAccesses);
+  for (int64_t row = 0; row < numLines; row += 64) {
+    char text[65];
+    int64_t column = 0;
+    for (; column < 64 && row + column < numLines; column++) {
+      const MemoryLineStatistics *stats = &memoryLines[row + column];
+      text[column] =
+          getMemoryLineHeatmapChar(stats->loads + stats->stores, maxAccesses);
+    }
+    text[column] = '\0';
+    printf("  %6ld |%s|\n", firstLineOffset + row * MEMORY_FOOTPRINT_LINE_SIZE,
+           text);
+  }
+  printf("  working set over time (distinct lines per %ld calls):\n",
+         workingSetInterval);
+  printf("  %12s %12s %12s\n", "calls", "interval", "cumulative");
+  for (int64_t i = 0; i < numWorkingSetSamples; i++) {
+    printf("  %12ld %12ld %12ld\n", workingSetSamples[i].calls,
+           workingSetSamples[i].intervalLines,
+           workingSetSamples[i].cumulativeLines);
+  }
+
+  const char *fileName = getenv("DYN_INSTR_COUNT_MEMORY_FILE");
+  if (!fileName) fileName = DEFAULT_MEMORY_FOOTPRINT_FILE;
+  FILE *file = fopen(fileName, "w");
+  if (file) {
+    fprintf(file, "offset,loads,stores,calls\n");
+    for (int64_t i = 0; i < numLines; i++) {
+      fprintf(file, "%ld,%ld,%ld,%ld\n",
+              firstLineOffset + i * MEMORY_FOOTPRINT_LINE_SIZE,
+              memoryLines[i].loads, memoryLines[i].stores,
+              memoryLines[i].calls);
+    }
+    fclose(file);
+    printf("Per-line statistics of RoboMemory were written to %s\n", fileName);
+  } else {
+    fprintf(stderr, "Can't open %s for writing\n", fileName);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Counter banks
+//
+// The counting window is split between banks: counting starts in
+// ROBO_PREDICT_COUNTER_BANK (or the bank given to
+// enableDynamicInstructionCountingInBank()) and selectCounterBank() attributes
+// the following instructions to another bank. The Robo banks make up the
+// metric of computational cost. SPACESHIP_COMPUTER_COUNTER_BANK is a reference
+// bank: its instructions are reported on their own and removed from the
+// counters of the metric and from the detailed counters (per opcode, vector
+// operations, per basic block) when counting is disabled.
+
+#define ROBO_PREDICT_COUNTER_BANK 0
+#define ROBO_OBSERVE_COUNTER_BANK 1
+#define SPACESHIP_COMPUTER_COUNTER_BANK 2
+#define NUM_COUNTER_BANKS 3
+
+struct CounterBank {
+  const char *name;
+  // Number of times the bank was selected
+  int64_t calls;
+  int64_t additiveInstructionCounter;
+  int64_t multiplicativeInstructionCounter;
+  int64_t bitwiseInstructionCounter;
+};
+
+CounterBank counterBanks[NUM_COUNTER_BANKS] = {
+    {"Robo predict", 0, 0, 0, 0},
+    {"Robo observe", 0, 0, 0, 0},
+    {"spaceship computer", 0, 0, 0, 0}};
+int64_t currentCounterBank;
+// Counter values when the current bank was selected
+int64_t additiveInstructionCounterAtBankSelection;
+int64_t multiplicativeInstructionCounterAtBankSelection;
+int64_t bitwiseInstructionCounterAtBankSelection;
+
+void closeCurrentCounterBank() {
+  CounterBank *bank = &counterBanks[currentCounterBank];
+  bank->calls++;
+  bank->additiveInstructionCounter +=
+      additiveInstructionCounter - additiveInstructionCounterAtBankSelection;
+  bank->multiplicativeInstructionCounter +=
+      multiplicativeInstructionCounter -
+      multiplicativeInstructionCounterAtBankSelection;
+  bank->bitwiseInstructionCounter +=
+      bitwiseInstructionCounter - bitwiseInstructionCounterAtBankSelection;
+}
+
+void selectCounterBankWithCountingDisabled(int64_t bank) {
+  if (bank < 0 || bank >= NUM_COUNTER_BANKS) {
+    fprintf(stderr, "Unknown counter bank %ld\n", bank);
+    exit(1);
+  }
+  closeCurrentCounterBank();
+  currentCounterBank = bank;
+  additiveInstructionCounterAtBankSelection = additiveInstructionCounter;
+  multiplicativeInstructionCounterAtBankSelection =
+      multiplicativeInstructionCounter;
+  bitwiseInstructionCounterAtBankSelection = bitwiseInstructionCounter;
+}
+
+// Switch counting off while changing the bank, so that the bookkeeping is not
+// charged. Only Robo banks can be selected inside a Robo window.
+void selectCounterBank(int64_t bank) {
+  int64_t isEnabled = isDynamicInstructionCountingEnabled;
+  isDynamicInstructionCountingEnabled = 0;
+  selectCounterBankWithCountingDisabled(bank);
+  isDynamicInstructionCountingEnabled = isEnabled;
+}
+
+void printCounterBankReport(int totalNumberOfPlanets) {
+  int numUsedBanks = 0;
+  for (int bank = 0; bank < NUM_COUNTER_BANKS; bank++) {
+    numUsedBanks += counterBanks[bank].calls > 0;
+  }
+  if (numUsedBanks <= 1) return;
+  printf("Cost per counter bank:\n");
+  printf("%20s %12s %14s %14s %14s %14s %12s\n", "bank", "calls", "additive",
+         "multiplic.", "bitwise", "metric", "per planet");
+  for (int bank = 0; bank < NUM_COUNTER_BANKS; bank++) {
+    const CounterBank *counters = &counterBanks[bank];
+    int64_t cost = computeComputationalCost(
+        counters->additiveInstructionCounter,
+        counters->multiplicativeInstructionCounter,
+        counters->bitwiseInstructionCounter);
+    printf("%20s %12ld %14ld %14ld %14ld %14ld %12.2f\n", counters->name,
+           counters->calls, counters->additiveInstructionCounter,
+           counters->multiplicativeInstructionCounter,
+           counters->bitwiseInstructionCounter, cost,
+           (double)cost / totalNumberOfPlanets);
+  }
+}
+
+// Detailed counters when counting was enabled in the spaceship computer bank
+int64_t opcodeInstructionCounterAtEnable[MAX_OPCODE_COUNTERS];
+int64_t vectorOperationCounterAtEnable[NUM_VECTOR_COUNTER_KINDS][3];
+
+// Defined with the per-basic-block records
+void saveBasicBlockCosts();
+void restoreBasicBlockCosts();
+
+void saveDetailedCounters() {
+  memcpy(opcodeInstructionCounterAtEnable, opcodeInstructionCounter,
+         sizeof(opcodeInstructionCounter));
+  memcpy(vectorOperationCounterAtEnable, vectorOperationCounter,
+         sizeof(vectorOperationCounter));
+  saveBasicBlockCosts();
+}
+
+void restoreDetailedCounters() {
+  memcpy(opcodeInstructionCounter, opcodeInstructionCounterAtEnable,
+         sizeof(opcodeInstructionCounter));
+  memcpy(vectorOperationCounter, vectorOperationCounterAtEnable,
+         sizeof(vectorOperationCounter));
+  restoreBasicBlockCosts();
+}
+
+// Note that enableDynamicInstructionCounting() must not contain any counted
+// instructions: its basic block is charged after the flag is set
 void enableDynamicInstructionCounting() {
+  additiveInstructionCounterAtEnable = additiveInstructionCounter;
+  multiplicativeInstructionCounterAtEnable = multiplicativeInstructionCounter;
+  bitwiseInstructionCounterAtEnable = bitwiseInstructionCounter;
+  additiveInstructionCounterAtBankSelection = additiveInstructionCounter;
+  multiplicativeInstructionCounterAtBankSelection =
+      multiplicativeInstructionCounter;
+  bitwiseInstructionCounterAtBankSelection = bitwiseInstructionCounter;
+  currentCounterBank = ROBO_PREDICT_COUNTER_BANK;
   isDynamicInstructionCountingEnabled = 1;
 }
+void enableDynamicInstructionCountingInBank(int64_t bank) {
+  if (bank < 0 || bank >= NUM_COUNTER_BANKS) {
+    fprintf(stderr, "Unknown counter bank %ld\n", bank);
+    exit(1);
+  }
+  if (bank == SPACESHIP_COMPUTER_COUNTER_BANK) saveDetailedCounters();
+  enableDynamicInstructionCounting();
+  currentCounterBank = bank;
+}
 void disableDynamicInstructionCounting() {
   isDynamicInstructionCountingEnabled = 0;
+  closeCurrentCounterBank();
+  if (currentCounterBank == SPACESHIP_COMPUTER_COUNTER_BANK) {
+    // Reference code is not part of the metric
+    additiveInstructionCounter = additiveInstructionCounterAtEnable;
+    multiplicativeInstructionCounter = multiplicativeInstructionCounterAtEnable;
+    bitwiseInstructionCounter = bitwiseInstructionCounterAtEnable;
+    restoreDetailedCounters();
+    return;
+  }
+  recordCallCost();
+  recordMemoryFootprintOfCall();
 }
 void resetInstructionCountingStatistics() {
   additiveInstructionCounter = 0;
   multiplicativeInstructionCounter = 0;
   bitwiseInstructionCounter = 0;
+  memset(callCostHistograms, 0, sizeof(callCostHistograms));
+  memset(opcodeInstructionCounter, 0, sizeof(opcodeInstructionCounter));
+  memset(vectorOperationCounter, 0, sizeof(vectorOperationCounter));
+  resetMemoryFootprint();
+  resetCostRegions();
+  for (int bank = 0; bank < NUM_COUNTER_BANKS; bank++) {
+    counterBanks[bank].calls = 0;
+    counterBanks[bank].additiveInstructionCounter = 0;
+    counterBanks[bank].multiplicativeInstructionCounter = 0;
+    counterBanks[bank].bitwiseInstructionCounter = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Per-basic-block cost attribution
+//
+// When a module is compiled with DYN_INSTR_COUNT_PER_BLOCK=1 set in the
+// environment, the counting pass gives every instrumented basic block its own
+// record and registers the records of the module at startup. The records are
+// reported by printInstructionCountingStatistics().
+
+// The layout must match getBlockRecordType() in DynamicInstructionCounting.cpp
+struct BasicBlockCostRecord {
+  const char *functionName;
+  const char *fileName;
+  int64_t line;
+  int64_t additiveInstructionCounter;
+  int64_t multiplicativeInstructionCounter;
+  int64_t bitwiseInstructionCounter;
+};
+
+#define MAX_BASIC_BLOCK_COST_TABLES 256
+#define DEFAULT_BASIC_BLOCK_COST_REPORT_TOP 20
+#define DEFAULT_BASIC_BLOCK_COST_FOLDED_FILE "instruction_counting.folded"
+
+BasicBlockCostRecord *basicBlockCostTables[MAX_BASIC_BLOCK_COST_TABLES];
+int64_t basicBlockCostTableSizes[MAX_BASIC_BLOCK_COST_TABLES];
+int numBasicBlockCostTables;
+// Copies of the records taken by saveBasicBlockCosts()
+BasicBlockCostRecord *basicBlockCostSnapshots[MAX_BASIC_BLOCK_COST_TABLES];
+
+// Called from a constructor emitted by the counting pass (one per module)
+extern "C" void registerBasicBlockCostRecords(BasicBlockCostRecord *records,
+                                              int64_t numRecords) {
+  if (numBasicBlockCostTables == MAX_BASIC_BLOCK_COST_TABLES) {
+    fprintf(stderr, "Too many modules with per-basic-block counters\n");
+    return;
+  }
+  BasicBlockCostRecord *snapshot =
+      (BasicBlockCostRecord *)malloc(numRecords * sizeof(BasicBlockCostRecord));
+  if (!snapshot) {
+    fprintf(stderr, "Cannot allocate a copy of per-basic-block counters\n");
+    return;
+  }
+  basicBlockCostTables[numBasicBlockCostTables] = records;
+  basicBlockCostTableSizes[numBasicBlockCostTables] = numRecords;
+  basicBlockCostSnapshots[numBasicBlockCostTables] = snapshot;
+  numBasicBlockCostTables++;
+}
+
+void saveBasicBlockCosts() {
+  for (int i = 0; i < numBasicBlockCostTables; i++) {
+    memcpy(basicBlockCostSnapshots[i], basicBlockCostTables[i],
+           basicBlockCostTableSizes[i] * sizeof(BasicBlockCostRecord));
+  }
+}
+
+void restoreBasicBlockCosts() {
+  for (int i = 0; i < numBasicBlockCostTables; i++) {
+    memcpy(basicBlockCostTables[i], basicBlockCostSnapshots[i],
+           basicBlockCostTableSizes[i] * sizeof(BasicBlockCostRecord));
+  }
+}
+
+int64_t getBasicBlockCost(const BasicBlockCostRecord *record) {
+  return computeComputationalCost(record->additiveInstructionCounter,
+                                  record->multiplicativeInstructionCounter,
+                                  record->bitwiseInstructionCounter);
+}
+
+int compareBasicBlockCostRecordsBySourceLine(const void *a, const void *b) {
+  const BasicBlockCostRecord *lhs = (const BasicBlockCostRecord *)a;
+  const BasicBlockCostRecord *rhs = (const BasicBlockCostRecord *)b;
+  int cmp = strcmp(lhs->fileName, rhs->fileName);
+  if (cmp == 0) cmp = (lhs->line > rhs->line) - (lhs->line < rhs->line);
+  if (cmp == 0) cmp = strcmp(lhs->functionName, rhs->functionName);
+  return cmp;
+}
+
+int compareBasicBlockCostRecordsByCost(const void *a, const void *b) {
+  int64_t lhs = getBasicBlockCost((const BasicBlockCostRecord *)a);
+  int64_t rhs = getBasicBlockCost((const BasicBlockCostRecord *)b);
+  return (lhs < rhs) - (lhs > rhs);
+}
+
+// Print the most expensive source lines and write all of them in the folded
+// stack format ("function;file:line cost") accepted by flamegraph.pl.
+// The number of reported lines and the name of the folded file can be set with
+// DYN_INSTR_COUNT_REPORT_TOP and DYN_INSTR_COUNT_FOLDED_FILE.
+void printBasicBlockCostReport() {
+  int64_t numRecords = 0;
+  for (int i = 0; i < numBasicBlockCostTables; i++) {
+    numRecords += basicBlockCostTableSizes[i];
+  }
+  if (numRecords == 0) return;
+
+  // Merge the records of basic blocks sharing the same source line
+  BasicBlockCostRecord *lines = (BasicBlockCostRecord *)malloc(
+      numRecords * sizeof(BasicBlockCostRecord));
+  if (!lines) return;
+  int64_t numLines = 0;
+  for (int i = 0; i < numBasicBlockCostTables; i++) {
+    for (int64_t j = 0; j < basicBlockCostTableSizes[i]; j++) {
+      if (getBasicBlockCost(&basicBlockCostTables[i][j]) > 0) {
+        lines[numLines++] = basicBlockCostTables[i][j];
+      }
+    }
+  }
+  qsort(lines, numLines, sizeof(BasicBlockCostRecord),
+        compareBasicBlockCostRecordsBySourceLine);
+  int64_t numMerged = 0;
+  for (int64_t i = 0; i < numLines; i++) {
+    if (numMerged > 0 &&
+        compareBasicBlockCostRecordsBySourceLine(&lines[numMerged - 1],
+                                                 &lines[i]) == 0) {
+      lines[numMerged - 1].additiveInstructionCounter +=
+          lines[i].additiveInstructionCounter;
+      lines[numMerged - 1].multiplicativeInstructionCounter +=
+          lines[i].multiplicativeInstructionCounter;
+      lines[numMerged - 1].bitwiseInstructionCounter +=
+          lines[i].bitwiseInstructionCounter;
+    } else {
+      lines[numMerged++] = lines[i];
+    }
+  }
+  qsort(lines, numMerged, sizeof(BasicBlockCostRecord),
+        compareBasicBlockCostRecordsByCost);
+
+  int64_t totalCost = 0;
+  for (int64_t i = 0; i < numMerged; i++) {
+    totalCost += getBasicBlockCost(&lines[i]);
+  }
+
+  const char *topEnv = getenv("DYN_INSTR_COUNT_REPORT_TOP");
+  int64_t top = topEnv ? atol(topEnv) : DEFAULT_BASIC_BLOCK_COST_REPORT_TOP;
+  printf("Most expensive source lines (%ld of %ld):\n",
+         top < numMerged ? top : numMerged, numMerged);
+  printf("%14s %7s %12s %12s %12s  %s\n", "cost", "share", "additive",
+         "multiplic.", "bitwise", "location");
+  for (int64_t i = 0; i < numMerged && i < top; i++) {
+    printf("%14ld %6.2f%% %12ld %12ld %12ld  %s:%ld (%s)\n",
+           getBasicBlockCost(&lines[i]),
+           100.0 * getBasicBlockCost(&lines[i]) / totalCost,
+           lines[i].additiveInstructionCounter,
+           lines[i].multiplicativeInstructionCounter,
+           lines[i].bitwiseInstructionCounter, lines[i].fileName,
+           lines[i].line, lines[i].functionName);
+  }
+
+  const char *foldedFileName = getenv("DYN_INSTR_COUNT_FOLDED_FILE");
+  if (!foldedFileName) foldedFileName = DEFAULT_BASIC_BLOCK_COST_FOLDED_FILE;
+  FILE *foldedFile = fopen(foldedFileName, "w");
+  if (foldedFile) {
+    for (int64_t i = 0; i < numMerged; i++) {
+      fprintf(foldedFile, "%s;%s:%ld %ld\n", lines[i].functionName,
+              lines[i].fileName, lines[i].line, getBasicBlockCost(&lines[i]));
+    }
+    fclose(foldedFile);
+    printf("Per-line costs in folded stack format were written to %s\n",
+           foldedFileName);
+  } else {
+    fprintf(stderr, "Can't open %s for writing\n", foldedFileName);
+  }
+  free(lines);
+}
+
+//------------------------------------------------------------------------------
+// Per-opcode counters (DYN_INSTR_COUNT_OPCODES=1 when building with the
+// development plugin)
+//
+// Every executed LLVM instruction in the counting window is counted by opcode,
+// and the counts are weighted with a cost table. The default table reproduces
+// the official metric. Another one can be loaded at startup from the file named
+// by DYN_INSTR_COUNT_WEIGHTS, with one "<opcode> <weight>" pair per line (e.g.
+// "load 4") and '#' starting a comment. Opcodes missing from the file cost 0.
+
+#define MAX_OPCODE_NAME_LENGTH 32
+
+const char *opcodeNames[MAX_OPCODE_COUNTERS];
+
+struct InstructionCostWeight {
+  char opcodeName[MAX_OPCODE_NAME_LENGTH];
+  double weight;
+};
+
+InstructionCostWeight instructionCostWeights[MAX_OPCODE_COUNTERS] = {
+    {"add", ADDITIVE_OP_COST},        {"fadd", ADDITIVE_OP_COST},
+    {"sub", ADDITIVE_OP_COST},        {"fsub", ADDITIVE_OP_COST},
+    {"mul", MULTIPLICATIVE_OP_COST},  {"fmul", MULTIPLICATIVE_OP_COST},
+    {"udiv", MULTIPLICATIVE_OP_COST}, {"sdiv", MULTIPLICATIVE_OP_COST},
+    {"fdiv", MULTIPLICATIVE_OP_COST}, {"urem", MULTIPLICATIVE_OP_COST},
+    {"srem", MULTIPLICATIVE_OP_COST}, {"frem", MULTIPLICATIVE_OP_COST},
+    {"fneg", BITWISE_OP_COST},        {"ashr", BITWISE_OP_COST},
+    {"and", BITWISE_OP_COST},         {"or", BITWISE_OP_COST},
+    {"xor", BITWISE_OP_COST},         {"icmp", BITWISE_OP_COST},
+    {"fcmp", BITWISE_OP_COST}};
+int numInstructionCostWeights = 19;
+const char *instructionCostWeightsFileName = "official metric";
+
+// Called from a constructor emitted by the counting pass for every opcode
+// counted in a module
+extern "C" void registerOpcodeName(int64_t opcode, const char *name) {
+  if (opcode >= 0 && opcode < MAX_OPCODE_COUNTERS) opcodeNames[opcode] = name;
+}
+
+__attribute__((constructor)) void loadInstructionCostWeights() {
+  const char *fileName = getenv("DYN_INSTR_COUNT_WEIGHTS");
+  if (!fileName) return;
+  FILE *file = fopen(fileName, "r");
+  if (!file) {
+    fprintf(stderr, "Can't open the cost weight file %s\n", fileName);
+    exit(1);
+  }
+  numInstructionCostWeights = 0;
+  char line[256];
+  int lineNumber = 0;
+  while (fgets(line, sizeof(line), file)) {
+    lineNumber++;
+    char *comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+    InstructionCostWeight entry;
+    char rest;
+    int numFields =
+        sscanf(line, "%31s %lf %c", entry.opcodeName, &entry.weight, &rest);
+    if (numFields <= 0) continue;
+    if (numFields != 2 ||
+        numInstructionCostWeights == MAX_OPCODE_COUNTERS) {
+      fprintf(stderr, "%s:%d: expected \"<opcode> <weight>\"\n", fileName,
+              lineNumber);
+      exit(1);
+    }
+    instructionCostWeights[numInstructionCostWeights++] = entry;
+  }
+  fclose(file);
+  instructionCostWeightsFileName = fileName;
+}
+
+double getInstructionCostWeight(const char *opcodeName) {
+  for (int i = 0; i < numInstructionCostWeights; i++) {
+    if (strcmp(instructionCostWeights[i].opcodeName, opcodeName) == 0) {
+      return instructionCostWeights[i].weight;
+    }
+  }
+  return 0;
+}
+
+int compareOpcodesByCount(const void *a, const void *b) {
+  int64_t lhs = opcodeInstructionCounter[*(const int *)a];
+  int64_t rhs = opcodeInstructionCounter[*(const int *)b];
+  return (lhs < rhs) - (lhs > rhs);
+}
+
+void printInstructionMixReport(int totalNumberOfPlanets) {
+  int opcodes[MAX_OPCODE_COUNTERS];
+  int numOpcodes = 0;
+  for (int opcode = 0; opcode < MAX_OPCODE_COUNTERS; opcode++) {
+    if (opcodeNames[opcode] && opcodeInstructionCounter[opcode] > 0) {
+      opcodes[numOpcodes++] = opcode;
+    }
+  }
+  if (numOpcodes == 0) return;
+  qsort(opcodes, numOpcodes, sizeof(int), compareOpcodesByCount);
+
+  printf("Instruction mix:\n");
+  printf("%16s %14s %12s %8s %16s\n", "opcode", "count", "per planet",
+         "weight", "cost");
+  double totalCost = 0;
+  for (int i = 0; i < numOpcodes; i++) {
+    int opcode = opcodes[i];
+    double weight = getInstructionCostWeight(opcodeNames[opcode]);
+    double cost = weight * opcodeInstructionCounter[opcode];
+    totalCost += cost;
+    printf("%16s %14ld %12.2f %8.2f %16.0f\n", opcodeNames[opcode],
+           opcodeInstructionCounter[opcode],
+           (double)opcodeInstructionCounter[opcode] / totalNumberOfPlanets,
+           weight, cost);
+  }
+  printf("Weighted metric of computational cost (%s): %.0f (%f per planet)\n",
+         instructionCostWeightsFileName, totalCost,
+         totalCost / totalNumberOfPlanets);
+}
+
+//------------------------------------------------------------------------------
+// Vector operations and intrinsic calls
+//
+// The official metric charges a vector binary operator (e.g. an add of
+// <8 x i16>) like a scalar one, whatever its number of lanes, and never
+// charges intrinsic calls (e.g. llvm.vector.reduce.add or
+// llvm.x86.sse2.pmadd.wd). The per-lane metric charges every lane of both
+// with the weight of its category instead.
+
+void printVectorOperationReport(int totalNumberOfPlanets) {
+  static const char *const kindNames[NUM_VECTOR_COUNTER_KINDS] = {
+      "vector instructions", "vector lanes", "intrinsic calls",
+      "intrinsic lanes"};
+  int64_t numOperations = 0;
+  for (int kind = 0; kind < NUM_VECTOR_COUNTER_KINDS; kind++) {
+    for (int category = 0; category < 3; category++) {
+      numOperations += vectorOperationCounter[kind][category];
+    }
+  }
+  if (numOperations == 0) return;
+
+  printf("Vector operations and intrinsic calls:\n");
+  printf("%20s %14s %14s %14s\n", "", "additive", "multiplic.", "bitwise");
+  for (int kind = 0; kind < NUM_VECTOR_COUNTER_KINDS; kind++) {
+    printf("%20s %14ld %14ld %14ld\n", kindNames[kind],
+           vectorOperationCounter[kind][0], vectorOperationCounter[kind][1],
+           vectorOperationCounter[kind][2]);
+  }
+  int64_t laneCounts[3];
+  for (int category = 0; category < 3; category++) {
+    laneCounts[category] =
+        vectorOperationCounter[VECTOR_LANES][category] -
+        vectorOperationCounter[VECTOR_INSTRUCTIONS][category] +
+        vectorOperationCounter[INTRINSIC_LANES][category];
+  }
+  int64_t cost = computeComputationalCost(
+      additiveInstructionCounter + laneCounts[0],
+      multiplicativeInstructionCounter + laneCounts[1],
+      bitwiseInstructionCounter + laneCounts[2]);
+  printf("Metric of computational cost charged per lane: %ld (%f per "
+         "planet)\n",
+         cost, (float)cost / totalNumberOfPlanets);
 }
 
 void printInstructionCountingStatistics(int totalNumberOfPlanets) {
+#ifdef DYN_INSTR_COUNT_NATIVE
+  printf("Metric of computational cost: not measured by the native build\n");
+  return;
+#endif
   printf("Number of additive instructions: %ld (%f per planet)\n",
          additiveInstructionCounter,
          (float)additiveInstructionCounter / totalNumberOfPlanets);
@@ -54,4 +1054,31 @@ void printInstructionCountingStatistics(int totalNumberOfPlanets) {
                  multiplicativeInstructionCounter * MULTIPLICATIVE_OP_COST +
                  bitwiseInstructionCounter * BITWISE_OP_COST) /
              totalNumberOfPlanets);
+  printCounterBankReport(totalNumberOfPlanets);
+  printCallCostDistribution();
+  printCostRegionReport(totalNumberOfPlanets);
+  printInstructionMixReport(totalNumberOfPlanets);
+  printVectorOperationReport(totalNumberOfPlanets);
+  printMemoryFootprintReport();
+  printBasicBlockCostReport();
+}
+
+// Estimate the metric of the whole route from the cost of its first
+// sampledPlanets planets. The estimate assumes that the cost per planet of the
+// sample is representative, which does not hold if a prediction algorithm
+// costs more (or less) while it warms up.
+void printExtrapolatedComputationalCost(int sampledPlanets,
+                                        int totalNumberOfPlanets) {
+#ifdef DYN_INSTR_COUNT_NATIVE
+  return;
+#endif
+  if (sampledPlanets <= 0) return;
+  int64_t cost = computeComputationalCost(additiveInstructionCounter,
+                                          multiplicativeInstructionCounter,
+                                          bitwiseInstructionCounter);
+  double costPerPlanet = (double)cost / sampledPlanets;
+  printf("Extrapolated metric of computational cost for %d planets: %.0f (%f "
+         "per planet, from a sample of %d planets)\n",
+         totalNumberOfPlanets, costPerPlanet * totalNumberOfPlanets,
+         costPerPlanet, sampledPlanets);
 }
@@ -0,0 +1,16 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Weights of instruction categories in the metric of computational cost.
+// Shared by the counting API and the LLVM passes.
+
+#pragma once
+
+#define ADDITIVE_OP_COST 3
+#define MULTIPLICATIVE_OP_COST 7
+#define BITWISE_OP_COST 1
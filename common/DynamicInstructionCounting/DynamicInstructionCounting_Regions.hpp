@@ -0,0 +1,58 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Named cost regions for profiling parts of a prediction algorithm.
+//
+// Usage (e.g. in PredictionAlgorithm.cpp):
+//   #include "DynamicInstructionCounting/DynamicInstructionCounting_Regions.hpp"
+//   ...
+//   {
+//     COST_REGION("hash");
+//     ... code charged to the "hash" region ...
+//   }
+//
+// Regions can be nested; the cost of a region includes the cost of the
+// regions opened inside it. The report is printed by
+// printInstructionCountingStatistics(). Regions are compiled out unless
+// DYN_INSTR_COUNT_REGIONS is defined, e.g. with
+//   make LLCXXFLAGS=-DDYN_INSTR_COUNT_REGIONS
+//
+// Instructions are charged at the end of every basic block, so the operations
+// of the block that opens a region are attributed to the region.
+// The functions below are defined in DynamicInstructionCounting_API.hpp.
+
+#pragma once
+
+#ifdef DYN_INSTR_COUNT_REGIONS
+
+void enterCostRegion(const char *name);
+void exitCostRegion();
+
+struct ScopedCostRegion {
+  explicit ScopedCostRegion(const char *name) { enterCostRegion(name); }
+  ~ScopedCostRegion() { exitCostRegion(); }
+  ScopedCostRegion(const ScopedCostRegion &) = delete;
+  ScopedCostRegion &operator=(const ScopedCostRegion &) = delete;
+};
+
+#define COST_REGION_CONCAT_(a, b) a##b
+#define COST_REGION_CONCAT(a, b) COST_REGION_CONCAT_(a, b)
+#define COST_REGION(name) \
+  ScopedCostRegion COST_REGION_CONCAT(costRegion, __LINE__)(name)
+
+#else
+
+struct ScopedCostRegion {
+  explicit ScopedCostRegion(const char *) {}
+};
+
+#define COST_REGION(name) \
+  do {                    \
+  } while (0)
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Classification of LLVM IR instructions into the categories of the metric of
+// computational cost. Shared by the LLVM passes of the counting plugin.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "DynamicInstructionCounting_Cost.hpp"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/IntrinsicInst.h"
+
+enum InstructionCategory { ADDITIVE, MULTIPLICATIVE, BITWISE, NOT_COUNTED };
+
+// Map an LLVM IR instruction to the category it is charged under.
+// Note that the official metric charges compares as bitwise instructions,
+// while Shl and LShr are not charged.
+inline InstructionCategory classifyInstruction(const llvm::Instruction &I) {
+  switch (I.getOpcode()) {
+    case llvm::Instruction::Add:
+    case llvm::Instruction::FAdd:
+    case llvm::Instruction::Sub:
+    case llvm::Instruction::FSub:
+      return ADDITIVE;
+    case llvm::Instruction::Mul:
+    case llvm::Instruction::FMul:
+    case llvm::Instruction::UDiv:
+    case llvm::Instruction::SDiv:
+    case llvm::Instruction::FDiv:
+    case llvm::Instruction::URem:
+    case llvm::Instruction::SRem:
+    case llvm::Instruction::FRem:
+      return MULTIPLICATIVE;
+    case llvm::Instruction::FNeg:
+    case llvm::Instruction::AShr:
+    case llvm::Instruction::And:
+    case llvm::Instruction::Or:
+    case llvm::Instruction::Xor:
+    case llvm::Instruction::ICmp:
+    case llvm::Instruction::FCmp:
+      return BITWISE;
+    default:
+      return NOT_COUNTED;
+  }
+}
+
+const int64_t kInstructionCategoryCost[NOT_COUNTED] = {
+    ADDITIVE_OP_COST, MULTIPLICATIVE_OP_COST, BITWISE_OP_COST};
+
+// Map an intrinsic call to the category of the operation it performs.
+// Intrinsics are calls, so the official metric never charges them; the
+// category is only used to report them (DYN_INSTR_COUNT_VECTOR).
+inline InstructionCategory classifyIntrinsic(const llvm::IntrinsicInst &II) {
+  switch (II.getIntrinsicID()) {
+    case llvm::Intrinsic::vector_reduce_add:
+    case llvm::Intrinsic::vector_reduce_fadd:
+    case llvm::Intrinsic::sadd_sat:
+    case llvm::Intrinsic::uadd_sat:
+    case llvm::Intrinsic::ssub_sat:
+    case llvm::Intrinsic::usub_sat:
+    case llvm::Intrinsic::sadd_with_overflow:
+    case llvm::Intrinsic::uadd_with_overflow:
+    case llvm::Intrinsic::ssub_with_overflow:
+    case llvm::Intrinsic::usub_with_overflow:
+      return ADDITIVE;
+    case llvm::Intrinsic::vector_reduce_mul:
+    case llvm::Intrinsic::vector_reduce_fmul:
+    case llvm::Intrinsic::fma:
+    case llvm::Intrinsic::fmuladd:
+    case llvm::Intrinsic::smul_with_overflow:
+    case llvm::Intrinsic::umul_with_overflow:
+      return MULTIPLICATIVE;
+    case llvm::Intrinsic::vector_reduce_and:
+    case llvm::Intrinsic::vector_reduce_or:
+    case llvm::Intrinsic::vector_reduce_xor:
+    case llvm::Intrinsic::fabs:
+    case llvm::Intrinsic::bswap:
+    case llvm::Intrinsic::bitreverse:
+    case llvm::Intrinsic::ctpop:
+    case llvm::Intrinsic::ctlz:
+    case llvm::Intrinsic::cttz:
+    case llvm::Intrinsic::fshl:
+    case llvm::Intrinsic::fshr:
+      return BITWISE;
+    default:
+      break;
+  }
+
+  // x86 SIMD intrinsics (e.g. llvm.x86.sse2.pmadd.wd) by mnemonic. Only the
+  // arithmetic shifts (psra) match a charged instruction (ashr); logical
+  // shifts are free like scalar shl and lshr.
+  static const struct {
+    const char *mnemonic;
+    InstructionCategory category;
+  } x86Intrinsics[] = {
+      {".padd", ADDITIVE},       {".psub", ADDITIVE},
+      {".phadd", ADDITIVE},      {".phsub", ADDITIVE},
+      {".psad", ADDITIVE},       {".pmadd", MULTIPLICATIVE},
+      {".pmul", MULTIPLICATIVE}, {".psra", BITWISE},
+      {".pabs", BITWISE},        {".psign", BITWISE}};
+  llvm::StringRef name = II.getCalledFunction()->getName();
+  if (name.startswith("llvm.x86.")) {
+    for (const auto &intrinsic : x86Intrinsics) {
+      if (name.contains(intrinsic.mnemonic)) return intrinsic.category;
+    }
+  }
+  return NOT_COUNTED;
+}
+
+// Number of lanes of a value of the given type (1 for scalars)
+inline unsigned getNumLanes(const llvm::Type *type) {
+  if (const auto *vectorTy = llvm::dyn_cast<llvm::VectorType>(type)) {
+    return vectorTy->getElementCount().getKnownMinValue();
+  }
+  return 1;
+}
+
+// Number of lanes processed by an intrinsic call: the widest of its result
+// and arguments (e.g. the vector operand of a reduction)
+inline unsigned getNumLanes(const llvm::IntrinsicInst &II) {
+  unsigned numLanes = getNumLanes(II.getType());
+  for (const llvm::Value *arg : II.args()) {
+    numLanes = std::max(numLanes, getNumLanes(arg->getType()));
+  }
+  return numLanes;
+}
@@ -0,0 +1,344 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+#include "WorstCaseCostAnalysis.hpp"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "InstructionCategories.hpp"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Demangle/Demangle.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/LoopSimplify.h"
+#include "llvm/Transforms/Utils/Mem2Reg.h"
+
+using namespace llvm;
+
+namespace {
+
+// Functions analysed by default. Can be overridden with a comma-separated
+// list of (parts of) demangled names in DYN_INSTR_COUNT_WORST_CASE_FUNCTIONS.
+const char *const kDefaultTargets[] = {
+    "RoboPredictor::predictTimeOfDayOnNextPlanet",
+    "RoboPredictor::observeAndRecordTimeofdayOnNextPlanet"};
+
+// Number of instructions of every category on a path
+struct PathCost {
+  uint64_t counts[NOT_COUNTED] = {0, 0, 0};
+  // Set if the path goes through a loop without a derivable trip count or
+  // through recursion; the counts then cover a single iteration only
+  bool isUnbounded = false;
+
+  uint64_t metric() const {
+    uint64_t total = 0;
+    for (int category = ADDITIVE; category < NOT_COUNTED; category++) {
+      total = SaturatingMultiplyAdd(
+          counts[category], (uint64_t)kInstructionCategoryCost[category],
+          total);
+    }
+    return total;
+  }
+
+  PathCost &operator+=(const PathCost &other) {
+    for (int category = ADDITIVE; category < NOT_COUNTED; category++) {
+      counts[category] = SaturatingAdd(counts[category], other.counts[category]);
+    }
+    isUnbounded |= other.isUnbounded;
+    return *this;
+  }
+
+  PathCost scaled(uint64_t factor) const {
+    PathCost result = *this;
+    for (int category = ADDITIVE; category < NOT_COUNTED; category++) {
+      result.counts[category] = SaturatingMultiply(counts[category], factor);
+    }
+    return result;
+  }
+
+  // Keep the more expensive of two alternative paths
+  void takeMax(const PathCost &other) {
+    bool isUnboundedPath = isUnbounded || other.isUnbounded;
+    if (other.metric() > metric()) *this = other;
+    isUnbounded = isUnboundedPath;
+  }
+};
+
+std::string describeLocation(const DebugLoc &loc) {
+  if (!loc) return "<unknown location>";
+  return (loc->getFilename() + ":" + Twine(loc->getLine())).str();
+}
+
+class WorstCaseCostAnalyzer {
+ public:
+  PathCost getFunctionBound(Function &F) {
+    if (F.isIntrinsic()) return PathCost();
+    if (F.isDeclaration()) {
+      addNote("calls to " + demangle(F.getName().str()) +
+              " are not included: the function is not defined in this module");
+      return PathCost();
+    }
+    auto cached = functionBounds.find(&F);
+    if (cached != functionBounds.end()) return cached->second;
+    if (!functionsInProgress.insert(&F).second) {
+      addNote("recursion through " + demangle(F.getName().str()) +
+              " is unbounded");
+      PathCost recursion;
+      recursion.isUnbounded = true;
+      return recursion;
+    }
+    PathCost bound = computeFunctionBound(F);
+    functionsInProgress.erase(&F);
+    functionBounds[&F] = bound;
+    return bound;
+  }
+
+  const std::vector<std::string> &getNotes() const { return notes; }
+
+ private:
+  DenseMap<const Function *, PathCost> functionBounds;
+  SmallPtrSet<const Function *, 8> functionsInProgress;
+  std::vector<std::string> notes;
+  StringSet<> reportedNotes;
+
+  // State of the function being analysed
+  DenseMap<const BasicBlock *, PathCost> blockCosts;
+  DenseMap<const Loop *, PathCost> loopCosts;
+  std::string currentFunctionName;
+  LoopInfo *LI = nullptr;
+  ScalarEvolution *SE = nullptr;
+
+  void addNote(const std::string &note) {
+    if (reportedNotes.insert(note).second) notes.push_back(note);
+  }
+
+  PathCost computeBlockCost(BasicBlock &BB) {
+    PathCost cost;
+    for (Instruction &I : BB) {
+      InstructionCategory category = classifyInstruction(I);
+      if (category != NOT_COUNTED) cost.counts[category]++;
+      if (auto *call = dyn_cast<CallBase>(&I)) {
+        if (Function *callee = call->getCalledFunction()) {
+          cost += getFunctionBound(*callee);
+        } else if (!call->isInlineAsm()) {
+          addNote("indirect call at " + describeLocation(I.getDebugLoc()) +
+                  " is not included");
+        }
+      }
+    }
+    return cost;
+  }
+
+  PathCost computeFunctionBound(Function &F) {
+    // Callee bounds are computed here, before the state of this function is
+    // set up, because computing them reuses that state
+    DenseMap<const BasicBlock *, PathCost> originalBlockCosts;
+    for (BasicBlock &BB : F) originalBlockCosts[&BB] = computeBlockCost(BB);
+
+    // Trip counts can't be derived from the unoptimized IR seen at the start
+    // of the pipeline, so the loops are analysed on a copy of the function
+    // with promoted allocas. The copy has the same blocks and instruction
+    // categories as the original.
+    currentFunctionName = demangle(F.getName().str());
+    ValueToValueMapTy VMap;
+    Function *copy = CloneFunction(&F, VMap);
+    blockCosts.clear();
+    loopCosts.clear();
+    for (auto &entry : originalBlockCosts) {
+      blockCosts[cast<BasicBlock>(VMap[entry.first])] = entry.second;
+    }
+
+    PassBuilder PB;
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+    FunctionPassManager FPM;
+    FPM.addPass(PromotePass());
+    FPM.addPass(LoopSimplifyPass());
+    FPM.run(*copy, FAM);
+    LI = &FAM.getResult<LoopAnalysis>(*copy);
+    SE = &FAM.getResult<ScalarEvolutionAnalysis>(*copy);
+
+    PathCost bound =
+        getLongestPath(nullptr, &copy->getEntryBlock(), true).cost;
+
+    FAM.clear(*copy, copy->getName());
+    copy->eraseFromParent();
+    LI = nullptr;
+    SE = nullptr;
+    return bound;
+  }
+
+  // The loop directly nested in region (nullptr for the whole function) that
+  // contains BB, or nullptr if BB belongs to the region itself
+  Loop *getChildLoop(const Loop *region, const BasicBlock *BB) {
+    Loop *L = LI->getLoopFor(BB);
+    if (L == region) return nullptr;
+    while (L->getParentLoop() != region) L = L->getParentLoop();
+    return L;
+  }
+
+  PathCost getLoopCost(Loop *L) {
+    auto cached = loopCosts.find(L);
+    if (cached != loopCosts.end()) return cached->second;
+
+    // The header of a loop executing N times is followed by N-1 complete
+    // iterations and by one path leaving the loop
+    PathCost iteration = getLongestPath(L, L->getHeader(), false).cost;
+    Path exitPath = getLongestPath(L, L->getHeader(), true);
+    unsigned tripCount = SE->getSmallConstantMaxTripCount(L);
+    PathCost cost;
+    if (tripCount == 0 || !exitPath.exists) {
+      addNote("loop at " + describeLocation(L->getStartLoc()) + " in " +
+              currentFunctionName + " has no derivable trip count");
+      cost = iteration;
+      cost.isUnbounded = true;
+    } else {
+      cost = iteration.scaled(tripCount - 1);
+      cost += exitPath.cost;
+    }
+    loopCosts[L] = cost;
+    return cost;
+  }
+
+  struct Path {
+    bool exists = false;
+    PathCost cost;
+  };
+
+  // Most expensive path from the header of region (the entry block of the
+  // function if region is nullptr). A path ends when it leaves the region or,
+  // unless mustExitRegion is set, when it takes a back edge of the region.
+  // Loops nested in the region are collapsed into a single node with the cost
+  // of the whole loop.
+  Path getLongestPath(Loop *region, BasicBlock *header, bool mustExitRegion) {
+    DenseMap<const BasicBlock *, Path> paths;
+    SmallPtrSet<const BasicBlock *, 32> visiting;
+    return getLongestPathFrom(region, header, mustExitRegion, paths, visiting);
+  }
+
+  Path getLongestPathFrom(Loop *region, BasicBlock *node, bool mustExitRegion,
+                          DenseMap<const BasicBlock *, Path> &paths,
+                          SmallPtrSet<const BasicBlock *, 32> &visiting) {
+    auto cached = paths.find(node);
+    if (cached != paths.end()) return cached->second;
+    visiting.insert(node);
+
+    Loop *childLoop = getChildLoop(region, node);
+    SmallVector<BasicBlock *, 8> successors;
+    if (childLoop) {
+      childLoop->getUniqueExitBlocks(successors);
+    } else {
+      successors.append(succ_begin(node), succ_end(node));
+    }
+
+    Path longestTail;
+    longestTail.exists = successors.empty();
+    for (BasicBlock *successor : successors) {
+      if (region && !region->contains(successor)) {
+        longestTail.exists = true;
+        continue;
+      }
+      if (region && successor == region->getHeader()) {
+        longestTail.exists |= !mustExitRegion;
+        continue;
+      }
+      if (visiting.count(successor)) {
+        addNote("irreducible control flow in " + currentFunctionName +
+                " is unbounded");
+        longestTail.cost.isUnbounded = true;
+        continue;
+      }
+      Path tail = getLongestPathFrom(region, successor, mustExitRegion, paths,
+                                     visiting);
+      if (!tail.exists) continue;
+      longestTail.exists = true;
+      longestTail.cost.takeMax(tail.cost);
+    }
+
+    Path path = longestTail;
+    path.cost = childLoop ? getLoopCost(childLoop) : blockCosts.lookup(node);
+    path.cost += longestTail.cost;
+
+    visiting.erase(node);
+    paths[node] = path;
+    return path;
+  }
+};
+
+std::vector<std::string> getTargetNames() {
+  std::vector<std::string> targets;
+  const char *list = std::getenv("DYN_INSTR_COUNT_WORST_CASE_FUNCTIONS");
+  if (!list) {
+    targets.assign(std::begin(kDefaultTargets), std::end(kDefaultTargets));
+    return targets;
+  }
+  SmallVector<StringRef, 4> names;
+  StringRef(list).split(names, ',', -1, false);
+  for (StringRef name : names) targets.push_back(name.trim().str());
+  return targets;
+}
+
+}  // namespace
+
+PreservedAnalyses WorstCaseCostAnalysisPass::run(Module &M,
+                                                 ModuleAnalysisManager &) {
+  std::vector<std::string> targets = getTargetNames();
+  std::vector<Function *> functions;
+  for (Function &F : M) {
+    if (F.isDeclaration()) continue;
+    std::string name = demangle(F.getName().str());
+    for (const std::string &target : targets) {
+      if (name.find(target) != std::string::npos) {
+        functions.push_back(&F);
+        break;
+      }
+    }
+  }
+  if (functions.empty()) return PreservedAnalyses::all();
+
+  WorstCaseCostAnalyzer analyzer;
+  for (Function *F : functions) {
+    PathCost bound = analyzer.getFunctionBound(*F);
+    errs() << "Worst-case cost of a call of " << demangle(F->getName().str())
+           << ":\n";
+    errs() << "  additive instructions: " << bound.counts[ADDITIVE] << "\n";
+    errs() << "  multiplicative instructions: " << bound.counts[MULTIPLICATIVE]
+           << "\n";
+    errs() << "  bitwise instructions: " << bound.counts[BITWISE] << "\n";
+    if (bound.isUnbounded) {
+      errs() << "  metric of computational cost: unbounded (" << bound.metric()
+             << " with one iteration of every unbounded loop)\n";
+    } else {
+      errs() << "  metric of computational cost: " << bound.metric() << "\n";
+    }
+  }
+  for (const std::string &note : analyzer.getNotes()) {
+    errs() << "  note: " << note << "\n";
+  }
+  return PreservedAnalyses::all();
+}
@@ -0,0 +1,27 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Static analysis computing an upper bound of the metric of computational
+// cost of a single call of the Robo predictor entry points.
+//
+// The bound is the cost of the most expensive path through the function,
+// with loops charged as (maximum trip count) x (most expensive iteration) and
+// calls charged with the bound of the callee. Instructions are charged by
+// classifyInstruction like in the counting pass, so the compares of branch
+// conditions and loop exit tests are included. Loops without a derivable trip
+// count and calls to functions defined in other modules are reported.
+
+#pragma once
+
+#include "llvm/IR/PassManager.h"
+
+struct WorstCaseCostAnalysisPass
+    : public llvm::PassInfoMixin<WorstCaseCostAnalysisPass> {
+  llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &);
+  static bool isRequired() { return true; }
+};
@@ -0,0 +1,50 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Bimodal table: a saturating counter per planet, indexed by the low
+// LogSize bits of the planet ID.
+//
+// Storage: 2^LogSize bytes.
+// Cost per call: predict 4 bitwise, update 1 additive and 1 bitwise.
+
+#pragma once
+
+#include "PredictorComponents/PredictorComponent.hpp"
+
+template <int LogSize, int CounterBits = 2>
+class BimodalTable {
+ public:
+  static_assert(LogSize >= 1 && LogSize <= 24, "Unsupported table size");
+  static constexpr std::uint32_t SIZE = 1u << LogSize;
+  static constexpr std::size_t STORAGE_SIZE =
+      structSize<std::int8_t[SIZE]>();
+  static constexpr ComponentCost PREDICT_COST = {0, 0, 4};
+  static constexpr ComponentCost UPDATE_COST = {1, 0, 1};
+  static constexpr ComponentCost HISTORY_UPDATE_COST = {0, 0, 0};
+
+  using Counter = SaturatingCounter<CounterBits>;
+
+  struct Context {
+    std::uint32_t index;
+  };
+
+  ComponentPrediction predict(const PlanetInput &input, Context &context) {
+    context.index = input.planetID & (SIZE - 1);
+    return Counter::predict(counters[context.index]);
+  }
+
+  void update(const PlanetInput &, const Context &context, bool outcome) {
+    Counter::update(counters[context.index], outcome);
+  }
+
+  // No history
+  void updateHistory(const PlanetInput &, bool) {}
+
+ private:
+  std::int8_t counters[SIZE] = {};
+};
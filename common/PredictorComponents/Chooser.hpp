@@ -0,0 +1,107 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Chooser between two predictions: a saturating counter per planet (indexed
+// by the low LogSize bits of the planet ID) that learns which of the two is
+// right more often. It is trained only when the two predictions disagree.
+//
+// Tournament<First, Second, LogChooserSize> combines two components and a
+// chooser into a component with the usual interface.
+//
+// Chooser storage: 2^LogSize bytes.
+// Chooser cost per call: select 3 bitwise, update 1 additive and 3 bitwise.
+
+#pragma once
+
+#include "PredictorComponents/PredictorComponent.hpp"
+
+template <int LogSize, int CounterBits = 2>
+class Chooser {
+ public:
+  static_assert(LogSize >= 1 && LogSize <= 24, "Unsupported table size");
+  static constexpr std::uint32_t SIZE = 1u << LogSize;
+  static constexpr std::size_t STORAGE_SIZE =
+      structSize<std::int8_t[SIZE]>();
+  static constexpr ComponentCost SELECT_COST = {0, 0, 3};
+  static constexpr ComponentCost UPDATE_COST = {1, 0, 3};
+
+  using Counter = SaturatingCounter<CounterBits>;
+
+  struct Context {
+    std::uint32_t index;
+  };
+
+  // Returns the selected prediction. A prediction that is not a hit is never
+  // selected over one that is.
+  const ComponentPrediction &select(const PlanetInput &input, Context &context,
+                                    const ComponentPrediction &first,
+                                    const ComponentPrediction &second) {
+    context.index = input.planetID & (SIZE - 1);
+    if (first.isHit != second.isHit) return first.isHit ? first : second;
+    return counters[context.index] >= 0 ? second : first;
+  }
+
+  // Counts towards the second prediction when only it is right
+  void update(const Context &context, const ComponentPrediction &first,
+              const ComponentPrediction &second, bool outcome) {
+    if (first.outcome != second.outcome) {
+      Counter::update(counters[context.index], second.outcome == outcome);
+    }
+  }
+
+ private:
+  std::int8_t counters[SIZE] = {};
+};
+
+template <typename First, typename Second, int LogChooserSize,
+          int ChooserCounterBits = 2>
+class Tournament {
+ public:
+  using ChooserType = Chooser<LogChooserSize, ChooserCounterBits>;
+
+  static constexpr std::size_t STORAGE_SIZE =
+      structSize<First, Second, ChooserType>();
+  static constexpr ComponentCost PREDICT_COST =
+      First::PREDICT_COST + Second::PREDICT_COST + ChooserType::SELECT_COST;
+  static constexpr ComponentCost UPDATE_COST =
+      First::UPDATE_COST + Second::UPDATE_COST + ChooserType::UPDATE_COST;
+  static constexpr ComponentCost HISTORY_UPDATE_COST =
+      First::HISTORY_UPDATE_COST + Second::HISTORY_UPDATE_COST;
+
+  struct Context {
+    typename First::Context first;
+    typename Second::Context second;
+    typename ChooserType::Context chooser;
+    ComponentPrediction firstPrediction;
+    ComponentPrediction secondPrediction;
+  };
+
+  ComponentPrediction predict(const PlanetInput &input, Context &context) {
+    context.firstPrediction = first.predict(input, context.first);
+    context.secondPrediction = second.predict(input, context.second);
+    return chooser.select(input, context.chooser, context.firstPrediction,
+                          context.secondPrediction);
+  }
+
+  void update(const PlanetInput &input, const Context &context, bool outcome) {
+    first.update(input, context.first, outcome);
+    second.update(input, context.second, outcome);
+    chooser.update(context.chooser, context.firstPrediction,
+                   context.secondPrediction, outcome);
+  }
+
+  void updateHistory(const PlanetInput &input, bool outcome) {
+    first.updateHistory(input, outcome);
+    second.updateHistory(input, outcome);
+  }
+
+ private:
+  First first;
+  Second second;
+  ChooserType chooser;
+};
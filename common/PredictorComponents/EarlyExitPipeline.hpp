@@ -0,0 +1,195 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Early-exit pipeline: a composition of components that are evaluated from
+// the cheapest to the most expensive (by PREDICT_COST.metric(), sorted at
+// compile time) and stops at the first confident prediction:
+//
+//   EarlyExitPipeline<Stage<PeriodTable<12, 8, 14, 3>, 2>,
+//                     Stage<LoopTable<12>, 3>,
+//                     Stage<HashedPerceptron<4, 8>, 0>>
+//
+// Stage<Component, MinConfidence> exits when the component hits with a
+// confidence of at least MinConfidence (confidences are comparable only
+// within a component, so every stage has its own threshold). If no stage is
+// confident, the prediction of the last stage that hits is used, the first
+// stage's if none does.
+//
+// Updates are gated: the stages evaluated by predict() are trained. A skipped
+// stage is trained only on a misprediction and only if it is the first
+// skipped stage, the one that would have been consulted next; it is
+// evaluated at update time to do so. A stage that learns a planet becomes
+// confident and the stages after it stop paying for the planet; a stage
+// that doesn't passes the planet on, so deeper stages learn the hard cases.
+// Every stage that is not trained still shifts the outcome into its
+// histories (updateHistory()), so they don't go stale while it is skipped.
+//
+// FullPipeline<Stages...> makes the same predictions without early exit: it
+// evaluates and trains every stage, which is the reference for the accuracy
+// and the cost of an early-exit pipeline.
+//
+// PREDICT_COST and UPDATE_COST are the worst case (no early exit), including
+// the compares of the pipeline itself; UPDATE_COST also covers the predict()
+// of a skipped stage. callCost() bounds the cost of one predict() and
+// update() pair given its context, for cost reports like the component
+// benchmark.
+
+#pragma once
+
+#include <array>
+#include <tuple>
+
+#include "PredictorComponents/PredictorComponent.hpp"
+
+template <typename Component, int MinConfidence>
+struct Stage {
+  using Type = Component;
+  static constexpr int MIN_CONFIDENCE = MinConfidence;
+};
+
+namespace predictor_components_detail {
+
+// Indices of the stages from the cheapest to the most expensive; stages of
+// equal cost keep their order
+template <std::size_t N>
+constexpr std::array<int, N> sortByCost(const std::array<int, N> &costs) {
+  std::array<int, N> order = {};
+  for (std::size_t i = 0; i < N; i++) {
+    order[i] = (int)i;
+  }
+  for (std::size_t i = 1; i < N; i++) {
+    for (std::size_t j = i; j > 0 && costs[order[j]] < costs[order[j - 1]];
+         j--) {
+      int stage = order[j];
+      order[j] = order[j - 1];
+      order[j - 1] = stage;
+    }
+  }
+  return order;
+}
+
+}  // namespace predictor_components_detail
+
+template <bool IsEarlyExit, typename... Stages>
+class StagePipeline {
+ public:
+  static constexpr int NUM_STAGES = sizeof...(Stages);
+  static_assert(NUM_STAGES >= 1, "No stages");
+
+  using Components = std::tuple<typename Stages::Type...>;
+
+  // ORDER[i] is the stage evaluated i-th
+  static constexpr std::array<int, NUM_STAGES> ORDER =
+      predictor_components_detail::sortByCost<NUM_STAGES>(
+          {Stages::Type::PREDICT_COST.metric()...});
+  static constexpr int MIN_CONFIDENCES[NUM_STAGES] = {
+      Stages::MIN_CONFIDENCE...};
+
+  // Compares of the pipeline per stage: the confidence test in predict() and
+  // at most 3 tests to choose between training, evaluating and history
+  // updates in update()
+  static constexpr ComponentCost STAGE_PREDICT_COST = {0, 0, 1};
+  static constexpr ComponentCost STAGE_UPDATE_COST = {0, 0, 3};
+
+  static constexpr std::size_t STORAGE_SIZE = sizeof(Components);
+  static constexpr ComponentCost PREDICT_COST =
+      ((Stages::Type::PREDICT_COST + STAGE_PREDICT_COST) + ... +
+       ComponentCost{0, 0, 0});
+  // An early exit may evaluate the next stage in update(), at most the most
+  // expensive one
+  static constexpr ComponentCost UPDATE_COST =
+      ((Stages::Type::UPDATE_COST + STAGE_UPDATE_COST) + ... +
+       (IsEarlyExit ? std::tuple_element_t<ORDER[NUM_STAGES - 1],
+                                           Components>::PREDICT_COST
+                    : ComponentCost{0, 0, 0}));
+  static constexpr ComponentCost HISTORY_UPDATE_COST =
+      (Stages::Type::HISTORY_UPDATE_COST + ... + ComponentCost{0, 0, 0});
+
+  struct Context {
+    std::tuple<typename Stages::Type::Context...> stages;
+    // Number of stages evaluated by predict(), in the order of ORDER
+    int numEvaluated;
+    bool prediction;
+  };
+
+  ComponentPrediction predict(const PlanetInput &input, Context &context) {
+    ComponentPrediction prediction = {};
+    bool isConfident = false;
+    forEachIndex<NUM_STAGES>([&](auto i) {
+      if (IsEarlyExit && isConfident) return;
+      constexpr int stage = ORDER[decltype(i)::value];
+      ComponentPrediction stagePrediction = std::get<stage>(components).predict(
+          input, std::get<stage>(context.stages));
+      context.numEvaluated = decltype(i)::value + 1;
+      if (isConfident) return;
+      isConfident = stagePrediction.isHit &&
+                    stagePrediction.confidence >= MIN_CONFIDENCES[stage];
+      // The first stage's prediction until a stage hits
+      if constexpr (decltype(i)::value == 0) {
+        prediction = stagePrediction;
+      } else if (stagePrediction.isHit) {
+        prediction = stagePrediction;
+      }
+    });
+    context.prediction = prediction.outcome;
+    return prediction;
+  }
+
+  void update(const PlanetInput &input, const Context &context, bool outcome) {
+    forEachIndex<NUM_STAGES>([&](auto i) {
+      constexpr int stage = ORDER[decltype(i)::value];
+      auto &component = std::get<stage>(components);
+      if (decltype(i)::value < context.numEvaluated) {
+        component.update(input, std::get<stage>(context.stages), outcome);
+      } else if (IsEarlyExit && decltype(i)::value == context.numEvaluated &&
+                 context.prediction != outcome) {
+        typename std::tuple_element_t<stage, Components>::Context
+            stageContext{};
+        component.predict(input, stageContext);
+        component.update(input, stageContext, outcome);
+      } else {
+        component.updateHistory(input, outcome);
+      }
+    });
+  }
+
+  void updateHistory(const PlanetInput &input, bool outcome) {
+    forEachIndex<NUM_STAGES>([&](auto i) {
+      std::get<i>(components).updateHistory(input, outcome);
+    });
+  }
+
+  // Upper bound of the cost of predict() and update() for one planet
+  static ComponentCost callCost(const Context &context, bool outcome) {
+    ComponentCost cost = {0, 0, 0};
+    forEachIndex<NUM_STAGES>([&](auto i) {
+      using Component =
+          std::tuple_element_t<ORDER[decltype(i)::value], Components>;
+      if (decltype(i)::value < context.numEvaluated) {
+        cost = cost + STAGE_PREDICT_COST + Component::PREDICT_COST +
+               Component::UPDATE_COST;
+      } else if (IsEarlyExit && decltype(i)::value == context.numEvaluated &&
+                 context.prediction != outcome) {
+        cost = cost + Component::PREDICT_COST + Component::UPDATE_COST;
+      } else {
+        cost = cost + Component::HISTORY_UPDATE_COST;
+      }
+      cost = cost + STAGE_UPDATE_COST;
+    });
+    return cost;
+  }
+
+ private:
+  Components components;
+};
+
+template <typename... Stages>
+using EarlyExitPipeline = StagePipeline<true, Stages...>;
+
+template <typename... Stages>
+using FullPipeline = StagePipeline<false, Stages...>;
@@ -0,0 +1,122 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Group predictor for the planet group tags of task 2: planets of a group
+// may share their time of day, so the group tag predicts planets that were
+// never visited before.
+//
+// Every group tag has its own state: a history of the most recent
+// GroupHistoryBits outcomes seen in the group, a bias counter and a chooser
+// counter. A tagged table (TaggedTable) is indexed and tagged by a hash of
+// the group tag and its history, so it learns patterns within a group. The
+// group-driven prediction is the tagged table on a hit and the bias of the
+// group otherwise. The ID-driven prediction comes from IdComponent, any
+// component keyed by the planet ID. The chooser of the group selects between
+// the two and is trained when they disagree.
+//
+// In task 1 all planets have group tag 0 and the chooser settles on the
+// ID-driven prediction.
+//
+// Storage: 4 bytes per group tag (4 KiB), the tagged table and IdComponent.
+// Cost per call: predict 1 multiplicative and 12 bitwise, update 4 additive
+// and 9 bitwise, history update 2 bitwise, plus the costs of IdComponent.
+
+#pragma once
+
+#include "PredictorComponents/PredictorComponent.hpp"
+#include "PredictorComponents/TaggedTable.hpp"
+
+template <typename IdComponent, int LogTaggedSize, int GroupHistoryBits = 8,
+          int TagBits = 8>
+class GroupPredictor {
+ public:
+  static_assert(GroupHistoryBits >= 0 && GroupHistoryBits <= 16,
+                "Unsupported group history length");
+  // Group tags are in [0, GROUP_TAG_MAX] (see Route.hpp)
+  static constexpr int NUM_GROUP_TAGS = 1024;
+
+  using GroupTaggedTable = TaggedTable<LogTaggedSize, TagBits>;
+  using Counter = SaturatingCounter<3>;
+  using ChooserCounter = SaturatingCounter<2>;
+
+  struct Group {
+    std::uint16_t history;
+    std::int8_t bias;
+    // Non-negative when the ID-driven prediction is better for the group
+    std::int8_t chooser;
+  };
+
+  static constexpr std::size_t STORAGE_SIZE =
+      structSize<Group[NUM_GROUP_TAGS], GroupTaggedTable, IdComponent>();
+  static constexpr ComponentCost PREDICT_COST =
+      ComponentCost{0, 1, 6} + GroupTaggedTable::PREDICT_COST +
+      IdComponent::PREDICT_COST;
+  static constexpr ComponentCost UPDATE_COST =
+      ComponentCost{2, 0, 6} + GroupTaggedTable::UPDATE_COST +
+      IdComponent::UPDATE_COST;
+  static constexpr ComponentCost HISTORY_UPDATE_COST =
+      ComponentCost{0, 0, 2} + GroupTaggedTable::HISTORY_UPDATE_COST +
+      IdComponent::HISTORY_UPDATE_COST;
+
+  struct Context {
+    typename GroupTaggedTable::Context tagged;
+    typename IdComponent::Context id;
+    // Input of the tagged table: the hash of the group tag and its history
+    PlanetInput taggedInput;
+    ComponentPrediction groupPrediction;
+    ComponentPrediction idPrediction;
+  };
+
+  ComponentPrediction predict(const PlanetInput &input, Context &context) {
+    const Group &group = groups[input.groupTag];
+    // The tagged table takes its index from the low bits and its tag from
+    // the next ones, so the hash keeps the high bits of the product
+    std::uint64_t key =
+        (std::uint64_t)input.groupTag | ((std::uint64_t)group.history << 10);
+    context.taggedInput = {
+        (key * GOLDEN_RATIO) >> (64 - LogTaggedSize - TagBits),
+        input.spaceshipPrediction, input.groupTag};
+    ComponentPrediction tagged =
+        groupTagged.predict(context.taggedInput, context.tagged);
+    context.groupPrediction =
+        tagged.isHit ? tagged : Counter::predict(group.bias);
+    context.idPrediction = id.predict(input, context.id);
+    if (context.groupPrediction.isHit != context.idPrediction.isHit) {
+      return context.idPrediction.isHit ? context.idPrediction
+                                        : context.groupPrediction;
+    }
+    return group.chooser >= 0 ? context.idPrediction : context.groupPrediction;
+  }
+
+  void update(const PlanetInput &input, const Context &context, bool outcome) {
+    Group &group = groups[input.groupTag];
+    groupTagged.update(context.taggedInput, context.tagged, outcome);
+    id.update(input, context.id, outcome);
+    Counter::update(group.bias, outcome);
+    if (context.groupPrediction.outcome != context.idPrediction.outcome) {
+      ChooserCounter::update(group.chooser,
+                             context.idPrediction.outcome == outcome);
+    }
+    group.history = ((group.history << 1) | outcome) & HISTORY_MASK;
+  }
+
+  void updateHistory(const PlanetInput &input, bool outcome) {
+    Group &group = groups[input.groupTag];
+    groupTagged.updateHistory(input, outcome);
+    id.updateHistory(input, outcome);
+    group.history = ((group.history << 1) | outcome) & HISTORY_MASK;
+  }
+
+ private:
+  static constexpr std::uint64_t GOLDEN_RATIO = 0x9e3779b97f4a7c15ULL;
+  static constexpr std::uint32_t HISTORY_MASK = (1u << GroupHistoryBits) - 1;
+
+  Group groups[NUM_GROUP_TAGS] = {};
+  GroupTaggedTable groupTagged;
+  IdComponent id;
+};
@@ -0,0 +1,61 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Gshare table: saturating counters indexed by the planet ID xored with the
+// most recent HistoryLength outcomes. Histories longer than LogSize are
+// folded once, so outcomes older than 2 * LogSize alias.
+//
+// Storage: 2^LogSize bytes and an 8-byte history.
+// Cost per call: predict 6 bitwise, update 1 additive and 3 bitwise, history
+// update 2 bitwise.
+
+#pragma once
+
+#include "PredictorComponents/PredictorComponent.hpp"
+
+template <int LogSize, int HistoryLength, int CounterBits = 2>
+class GshareTable {
+ public:
+  static_assert(LogSize >= 1 && LogSize <= 24, "Unsupported table size");
+  static_assert(HistoryLength <= 2 * LogSize,
+                "History is longer than what the index can fold");
+  static constexpr std::uint32_t SIZE = 1u << LogSize;
+  static constexpr std::size_t STORAGE_SIZE =
+      structSize<OutcomeHistory<HistoryLength>, std::int8_t[SIZE]>();
+  static constexpr ComponentCost PREDICT_COST = {0, 0, 6};
+  static constexpr ComponentCost UPDATE_COST =
+      ComponentCost{1, 0, 1} + OutcomeHistory<HistoryLength>::UPDATE_COST;
+  static constexpr ComponentCost HISTORY_UPDATE_COST =
+      OutcomeHistory<HistoryLength>::UPDATE_COST;
+
+  using Counter = SaturatingCounter<CounterBits>;
+
+  struct Context {
+    std::uint32_t index;
+  };
+
+  ComponentPrediction predict(const PlanetInput &input, Context &context) {
+    context.index =
+        (input.planetID ^ history.value ^ (history.value >> LogSize)) &
+        (SIZE - 1);
+    return Counter::predict(counters[context.index]);
+  }
+
+  void update(const PlanetInput &, const Context &context, bool outcome) {
+    Counter::update(counters[context.index], outcome);
+    history.update(outcome);
+  }
+
+  void updateHistory(const PlanetInput &, bool outcome) {
+    history.update(outcome);
+  }
+
+ private:
+  OutcomeHistory<HistoryLength> history;
+  std::int8_t counters[SIZE] = {};
+};
@@ -0,0 +1,269 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Hashed perceptron: NumTables tables of 2^LogRows rows of 16 int8 weights.
+// Every table selects one row by a hash of the planet ID, the prediction of
+// the spaceship computer and a slice of the global outcome history of its own
+// length (none in table 0, 4 << k outcomes in table k), so a planet has
+// separate rows for the two hints. The 16 inputs of a row are a bias, the
+// prediction of the spaceship computer and the 14 most recent outcomes, each
+// +1 or -1. The prediction is the sign of the sum of the weights of all
+// selected rows multiplied by their inputs; its magnitude is the confidence.
+// On a misprediction or a sum within THRESHOLD of zero every selected weight
+// moves by one towards the product of its input and the outcome, saturating
+// at -128 and 127.
+//
+// The dot product and the training update process a whole row at once with
+// SSE2 (two rows with AVX2): the inputs are expanded to a byte mask, the
+// weights of -1 inputs are negated with a xor and summed with psadbw; the
+// weights are trained with saturating byte additions. Builds without SSE2
+// fall back to scalar code of a much higher cost.
+//
+// Storage: NumTables * 2^LogRows * 16 bytes and an 8-byte history, checked
+// against StorageBudget (the slice of RoboMemory given to the component).
+// HashedPerceptronWithin<NumTables, StorageBudget> picks the largest tables
+// that fit in the budget.
+// Cost per call (SSE2): predict NumTables + 4 additive, NumTables
+// multiplicative and 3 * NumTables + 7 bitwise; update 5 bitwise, including
+// the training; history update 1 bitwise.
+
+#pragma once
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+#include "PredictorComponents/PredictorComponent.hpp"
+
+template <int NumTables, int LogRows, std::size_t StorageBudget = 65536>
+class HashedPerceptron {
+ public:
+  static_assert(NumTables == 1 || NumTables == 2 || NumTables == 4 ||
+                    NumTables == 8,
+                "Unsupported number of tables");
+  static_assert(LogRows >= 1 && LogRows <= 20, "Unsupported table size");
+  static constexpr int NUM_INPUTS = 16;
+  static constexpr std::uint32_t ROWS = 1u << LogRows;
+
+  struct alignas(16) Row {
+    std::int8_t weights[NUM_INPUTS];
+  };
+
+  static constexpr std::size_t STORAGE_SIZE =
+      structSize<Row[NumTables][ROWS], std::uint64_t>();
+  static_assert(STORAGE_SIZE <= StorageBudget,
+                "Hashed perceptron exceeds its storage budget");
+
+  // Training threshold of the perceptron predictor (Jimenez and Lin):
+  // 1.93 * number of inputs + 14
+  static constexpr int THRESHOLD = 193 * NUM_INPUTS * NumTables / 100 + 14;
+
+  static constexpr ComponentCost PREDICT_COST = {NumTables + 4, NumTables,
+                                                 3 * NumTables + 7};
+  static constexpr ComponentCost UPDATE_COST = {0, 0, 5};
+  static constexpr ComponentCost HISTORY_UPDATE_COST = {0, 0, 1};
+
+  struct Context {
+    // 0xff for the inputs that are -1
+    alignas(16) std::int8_t negativeInputs[NUM_INPUTS];
+    std::uint32_t rows[NumTables];
+    int confidence;
+    bool prediction;
+  };
+
+  ComponentPrediction predict(const PlanetInput &input, Context &context) {
+    std::uint64_t key =
+        input.planetID ^
+        ((std::uint64_t)input.spaceshipPrediction << HINT_SHIFT);
+    forEachIndex<NumTables>(
+        [&](auto table) { context.rows[table] = rowIndex<table>(key); });
+    // Bit 0 is the bias, bit 1 the hint of the spaceship computer, bits 2 to
+    // 15 the most recent outcomes
+    std::uint32_t inputs =
+        ((history << 2) | ((std::uint32_t)input.spaceshipPrediction << 1) | 1) &
+        0xffff;
+    int sum = dotProduct(inputs, context);
+    context.prediction = sum >= 0;
+    context.confidence = sum >= 0 ? sum : -sum;
+    return {context.prediction, true, context.confidence};
+  }
+
+  void update(const PlanetInput &, const Context &context, bool outcome) {
+    if (context.prediction != outcome || context.confidence <= THRESHOLD) {
+      train(context, outcome);
+    }
+    history = (history << 1) | outcome;
+  }
+
+  void updateHistory(const PlanetInput &, bool outcome) {
+    history = (history << 1) | outcome;
+  }
+
+ private:
+  static constexpr std::uint64_t GOLDEN_RATIO = 0x9e3779b97f4a7c15ULL;
+  static constexpr int LOG_NUM_TABLES =
+      NumTables == 8 ? 3 : (NumTables == 4 ? 2 : (NumTables == 2 ? 1 : 0));
+  // Position of the hint in the hashed key, above the bits of planet IDs
+  static constexpr int HINT_SHIFT = 40;
+
+  template <int Table>
+  static constexpr std::uint64_t historyMask() {
+    constexpr int length = Table == 0 ? 0 : 4 << Table;
+    return length >= 64 ? ~0ULL : (1ULL << length) - 1;
+  }
+
+  // Fibonacci hashing keeps the high bits of the product, which depend on
+  // all bits of the key (planet ID and hint) and the history
+  template <int Table>
+  std::uint32_t rowIndex(std::uint64_t key) const {
+    if constexpr (Table == 0) {
+      return (key * GOLDEN_RATIO) >> (64 - LogRows);
+    } else {
+      return ((key ^ (history & historyMask<Table>())) * GOLDEN_RATIO) >>
+             (64 - LogRows);
+    }
+  }
+
+#ifdef __SSE2__
+  // Byte i of the result is 0xff if bit i of inputs is clear
+  static __m128i expandNegativeInputs(std::uint32_t inputs) {
+    // Broadcast the low byte of inputs to bytes 0-7 and the high byte to
+    // bytes 8-15
+    __m128i bytes = _mm_set1_epi16((short)inputs);
+    bytes = _mm_unpacklo_epi8(bytes, bytes);
+    bytes = _mm_unpacklo_epi16(bytes, bytes);
+    bytes = _mm_shuffle_epi32(bytes, _MM_SHUFFLE(1, 1, 0, 0));
+    __m128i bitOfByte = _mm_set1_epi64x(0x8040201008040201LL);
+    return _mm_cmpeq_epi8(_mm_and_si128(bytes, bitOfByte),
+                          _mm_setzero_si128());
+  }
+
+  // Flipping all bits of w gives -w - 1, flipping the sign bit gives the
+  // unsigned w + 128. psadbw of the weights xored with negativeInputs ^ 0x80
+  // against zero thus sums w + 128 over the +1 inputs and 127 - w over the
+  // -1 inputs: the dot product of the row plus 16 * 128 - (number of -1
+  // inputs).
+  int dotProduct(std::uint32_t inputs, Context &context) const {
+    __m128i negativeInputs = expandNegativeInputs(inputs);
+    _mm_store_si128((__m128i *)context.negativeInputs, negativeInputs);
+    __m128i xorMask = _mm_xor_si128(negativeInputs, _mm_set1_epi8(-128));
+    __m128i sums;
+#ifdef __AVX2__
+    if constexpr (NumTables >= 2) {
+      __m256i xorMask2 = _mm256_broadcastsi128_si256(xorMask);
+      __m256i sums2;
+      forEachIndex<NumTables / 2>([&](auto pair) {
+        constexpr int first = 2 * decltype(pair)::value;
+        __m256i weights = _mm256_set_m128i(
+            _mm_load_si128(
+                (const __m128i *)tables[first + 1][context.rows[first + 1]]
+                    .weights),
+            _mm_load_si128(
+                (const __m128i *)tables[first][context.rows[first]].weights));
+        __m256i sad = _mm256_sad_epu8(_mm256_xor_si256(weights, xorMask2),
+                                      _mm256_setzero_si256());
+        if constexpr (pair == 0) {
+          sums2 = sad;
+        } else {
+          sums2 = _mm256_add_epi64(sums2, sad);
+        }
+      });
+      sums = _mm_add_epi64(_mm256_castsi256_si128(sums2),
+                           _mm256_extracti128_si256(sums2, 1));
+    } else
+#endif
+    {
+      forEachIndex<NumTables>([&](auto table) {
+        __m128i weights = _mm_load_si128(
+            (const __m128i *)tables[table][context.rows[table]].weights);
+        __m128i sad =
+            _mm_sad_epu8(_mm_xor_si128(weights, xorMask), _mm_setzero_si128());
+        if constexpr (table == 0) {
+          sums = sad;
+        } else {
+          sums = _mm_add_epi64(sums, sad);
+        }
+      });
+    }
+    int sum = (int)_mm_cvtsi128_si64(sums) +
+              (int)_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums));
+    int numNegativeInputs = NUM_INPUTS - __builtin_popcount(inputs);
+    return sum + (numNegativeInputs << LOG_NUM_TABLES) -
+           NumTables * NUM_INPUTS * 128;
+  }
+
+  // Adds +1 to the weights whose input agrees with the outcome and -1 to the
+  // others: disagreeing lanes are 0xff, ored with 1 they stay -1
+  void train(const Context &context, bool outcome) {
+    __m128i negativeInputs =
+        _mm_load_si128((const __m128i *)context.negativeInputs);
+    __m128i disagree =
+        outcome ? negativeInputs
+                : _mm_xor_si128(negativeInputs, _mm_set1_epi8(-1));
+    __m128i delta = _mm_or_si128(disagree, _mm_set1_epi8(1));
+    forEachIndex<NumTables>([&](auto table) {
+      __m128i *weights =
+          (__m128i *)tables[table][context.rows[table]].weights;
+      _mm_store_si128(weights, _mm_adds_epi8(_mm_load_si128(weights), delta));
+    });
+  }
+#else
+  int dotProduct(std::uint32_t inputs, Context &context) const {
+    int sum = 0;
+    forEachIndex<NUM_INPUTS>([&](auto i) {
+      bool isPositive = (inputs >> i) & 1;
+      context.negativeInputs[i] = isPositive ? 0 : -1;
+      forEachIndex<NumTables>([&](auto table) {
+        int weight = tables[table][context.rows[table]].weights[i];
+        sum += isPositive ? weight : -weight;
+      });
+    });
+    return sum;
+  }
+
+  void train(const Context &context, bool outcome) {
+    forEachIndex<NUM_INPUTS>([&](auto i) {
+      bool agrees = (context.negativeInputs[i] == 0) == outcome;
+      forEachIndex<NumTables>([&](auto table) {
+        std::int8_t &weight = tables[table][context.rows[table]].weights[i];
+        if (agrees) {
+          if (weight < 127) weight++;
+        } else {
+          if (weight > -128) weight--;
+        }
+      });
+    });
+  }
+#endif
+
+  Row tables[NumTables][ROWS] = {};
+  std::uint64_t history = 0;
+};
+
+namespace predictor_components_detail {
+
+// Largest LogRows of a hashed perceptron of NumTables tables within the
+// budget
+template <int NumTables>
+constexpr int hashedPerceptronLogRows(std::size_t storageBudget) {
+  int logRows = 1;
+  while (logRows < 20 &&
+         NumTables * (std::size_t{16} << (logRows + 1)) + 16 <= storageBudget) {
+    logRows++;
+  }
+  return logRows;
+}
+
+}  // namespace predictor_components_detail
+
+template <int NumTables, std::size_t StorageBudget>
+using HashedPerceptronWithin = HashedPerceptron<
+    NumTables,
+    predictor_components_detail::hashedPerceptronLogRows<NumTables>(
+        StorageBudget),
+    StorageBudget>;
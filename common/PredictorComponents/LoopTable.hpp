@@ -0,0 +1,161 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Loop table: detects planets whose time of day repeats with a fixed period,
+// i.e. alternates runs of DAY and runs of NIGHT of constant lengths (a planet
+// that is DAY on 3 visits and NIGHT on the next one has runs of 3 and 1). An
+// entry per planet, tagged with the planet ID, packs into 32 bits:
+//   bits  0- 5 count      - visits of the current run so far
+//   bits  6-11 night run  - learned length of the runs of NIGHT (0: unknown)
+//   bits 12-17 day run    - learned length of the runs of DAY (0: unknown)
+//   bit     18 direction  - outcome of the current run
+//   bits 19-20 confidence - completed runs in a row of the learned lengths
+//   bits 21-22 age        - protects the entries of periodic planets
+//   bits 23-31 tag
+// The table predicts the end of the current run once its count reaches the
+// learned length of the run. A prediction is a hit only if the tag matches
+// and the confidence is saturated, so the component stays silent on planets
+// that are not periodic. Runs of up to 63 visits (periods of up to 126
+// visits) are learned.
+//
+// A tag miss replaces the entry if its age is 0 and ages it otherwise; a
+// correct confident prediction makes the entry young again.
+//
+// Storage: 4 * 2^LogSize bytes.
+// Cost per call: predict 11 bitwise, update 1 additive and 18 bitwise,
+// history update 1 additive and 8 bitwise.
+
+#pragma once
+
+#include "PredictorComponents/PredictorComponent.hpp"
+
+template <int LogSize>
+class LoopTable {
+ public:
+  static_assert(LogSize >= 1 && LogSize <= 24, "Unsupported table size");
+  static constexpr std::uint32_t SIZE = 1u << LogSize;
+  static constexpr std::size_t STORAGE_SIZE =
+      structSize<std::uint32_t[SIZE]>();
+  static constexpr ComponentCost PREDICT_COST = {0, 0, 11};
+  static constexpr ComponentCost UPDATE_COST = {1, 0, 18};
+  static constexpr ComponentCost HISTORY_UPDATE_COST = {1, 0, 8};
+
+  static constexpr std::uint32_t MAX_COUNT = 63;
+  static constexpr std::uint32_t MAX_CONFIDENCE = 3;
+  static constexpr std::uint32_t MAX_AGE = 3;
+  static constexpr int TAG_BITS = 9;
+
+  struct Context {
+    std::uint32_t index;
+    std::uint32_t entry;
+    std::uint16_t tag;
+    bool isHit;
+    bool isConfident;
+    bool prediction;
+  };
+
+  ComponentPrediction predict(const PlanetInput &input, Context &context) {
+    context.index = input.planetID & (SIZE - 1);
+    context.tag = (input.planetID >> LogSize) & TAG_MASK;
+    context.entry = entries[context.index];
+    context.isHit = (context.entry >> TAG_SHIFT) == context.tag;
+    bool direction = (context.entry >> DIRECTION_SHIFT) & 1;
+    std::uint32_t count = context.entry & RUN_MASK;
+    std::uint32_t runLength =
+        (context.entry >> (direction ? DAY_RUN_SHIFT : NIGHT_RUN_SHIFT)) &
+        RUN_MASK;
+    std::uint32_t confidence =
+        (context.entry >> CONFIDENCE_SHIFT) & MAX_CONFIDENCE;
+    // The run goes on until its count reaches the learned length
+    context.prediction = (count >= runLength) != direction;
+    context.isConfident = context.isHit && confidence == MAX_CONFIDENCE;
+    return {context.prediction, context.isConfident, (int)confidence};
+  }
+
+  void update(const PlanetInput &, const Context &context, bool outcome) {
+    std::uint32_t &entry = entries[context.index];
+    if (!context.isHit) {
+      if (((context.entry >> AGE_SHIFT) & MAX_AGE) == 0) {
+        std::uint32_t runLengths[2] = {0, 0};
+        entry = pack(context.tag, MAX_AGE, 0, outcome, runLengths, 1);
+      } else {
+        entry = context.entry - (1u << AGE_SHIFT);
+      }
+      return;
+    }
+    bool direction = (context.entry >> DIRECTION_SHIFT) & 1;
+    std::uint32_t count = context.entry & RUN_MASK;
+    // Indexed by the outcome of the run
+    std::uint32_t runLengths[2] = {
+        (context.entry >> NIGHT_RUN_SHIFT) & RUN_MASK,
+        (context.entry >> DAY_RUN_SHIFT) & RUN_MASK};
+    std::uint32_t confidence =
+        (context.entry >> CONFIDENCE_SHIFT) & MAX_CONFIDENCE;
+    std::uint32_t age = (context.entry >> AGE_SHIFT) & MAX_AGE;
+    if (outcome == direction) {
+      if (count < MAX_COUNT) count++;
+      // The run is longer than learned: the planet is not periodic, or
+      // its period changed
+      if (count > runLengths[direction] && runLengths[direction] != 0) {
+        confidence = 0;
+      }
+    } else {
+      // The run ended: check its length against the learned one
+      if (count == runLengths[direction]) {
+        if (confidence < MAX_CONFIDENCE) confidence++;
+      } else {
+        runLengths[direction] = count;
+        confidence = 0;
+      }
+      direction = outcome;
+      count = 1;
+    }
+    if (context.isConfident && context.prediction == outcome) age = MAX_AGE;
+    entry = pack(context.tag, age, confidence, direction, runLengths, count);
+  }
+
+  // Keeps the count of the current run of the planet without learning from
+  // it: the learned lengths, the confidence and the age are left as they are
+  void updateHistory(const PlanetInput &input, bool outcome) {
+    std::uint32_t &entry = entries[input.planetID & (SIZE - 1)];
+    if ((entry >> TAG_SHIFT) != ((input.planetID >> LogSize) & TAG_MASK)) {
+      return;
+    }
+    if (((entry >> DIRECTION_SHIFT) & 1) == outcome) {
+      if ((entry & RUN_MASK) < MAX_COUNT) entry++;
+    } else {
+      entry = (entry & ~(RUN_MASK | (1u << DIRECTION_SHIFT))) |
+              ((std::uint32_t)outcome << DIRECTION_SHIFT) | 1;
+    }
+  }
+
+ private:
+  static constexpr int NIGHT_RUN_SHIFT = 6;
+  static constexpr int DAY_RUN_SHIFT = 12;
+  static constexpr int DIRECTION_SHIFT = 18;
+  static constexpr int CONFIDENCE_SHIFT = 19;
+  static constexpr int AGE_SHIFT = 21;
+  static constexpr int TAG_SHIFT = 23;
+  static constexpr std::uint32_t RUN_MASK = MAX_COUNT;
+  static constexpr std::uint64_t TAG_MASK = (1u << TAG_BITS) - 1;
+  static_assert(TAG_SHIFT + TAG_BITS == 32, "Loop entry is not 32 bits");
+
+  // Costs 6 bitwise operations
+  static std::uint32_t pack(std::uint32_t tag, std::uint32_t age,
+                            std::uint32_t confidence, bool direction,
+                            const std::uint32_t (&runLengths)[2],
+                            std::uint32_t count) {
+    return (tag << TAG_SHIFT) | (age << AGE_SHIFT) |
+           (confidence << CONFIDENCE_SHIFT) |
+           ((std::uint32_t)direction << DIRECTION_SHIFT) |
+           (runLengths[1] << DAY_RUN_SHIFT) |
+           (runLengths[0] << NIGHT_RUN_SHIFT) | count;
+  }
+
+  std::uint32_t entries[SIZE] = {};
+};
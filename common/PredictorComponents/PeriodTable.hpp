@@ -0,0 +1,84 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Period table: a two-level local-history predictor for planets that repeat
+// a short pattern. The first level keeps the last HistoryBits outcomes seen
+// on every planet (indexed by the low LogSize bits of the planet ID); the
+// second level holds saturating counters indexed by that local history
+// combined with the planet ID. Any pattern with a period of at most
+// HistoryBits visits of the planet is learned once every phase of it has
+// been seen.
+//
+// Storage: 2^LogSize local histories of 1 or 2 bytes and 2^LogPatternSize
+// bytes of counters.
+// Cost per call: predict 6 bitwise, update 1 additive and 3 bitwise, history
+// update 3 bitwise.
+
+#pragma once
+
+#include <type_traits>
+
+#include "PredictorComponents/PredictorComponent.hpp"
+
+template <int LogSize, int HistoryBits, int LogPatternSize,
+          int CounterBits = 2>
+class PeriodTable {
+ public:
+  static_assert(LogSize >= 1 && LogSize <= 24, "Unsupported table size");
+  static_assert(LogPatternSize >= HistoryBits && LogPatternSize <= 24,
+                "Pattern table can't be indexed by the whole local history");
+  static_assert(HistoryBits >= 1 && HistoryBits <= 16,
+                "Unsupported local history length");
+  static constexpr std::uint32_t SIZE = 1u << LogSize;
+  static constexpr std::uint32_t PATTERN_SIZE = 1u << LogPatternSize;
+
+  using LocalHistory =
+      std::conditional_t<HistoryBits <= 8, std::uint8_t, std::uint16_t>;
+  using Counter = SaturatingCounter<CounterBits>;
+
+  static constexpr std::size_t STORAGE_SIZE =
+      structSize<LocalHistory[SIZE], std::int8_t[PATTERN_SIZE]>();
+  static constexpr ComponentCost PREDICT_COST = {0, 0, 6};
+  static constexpr ComponentCost UPDATE_COST = {1, 0, 3};
+  static constexpr ComponentCost HISTORY_UPDATE_COST = {0, 0, 3};
+
+  struct Context {
+    std::uint32_t index;
+    std::uint32_t patternIndex;
+  };
+
+  ComponentPrediction predict(const PlanetInput &input, Context &context) {
+    context.index = input.planetID & (SIZE - 1);
+    // The local history in the low bits, planet ID bits above it
+    context.patternIndex = (localHistories[context.index] ^
+                            (input.planetID << HistoryBits)) &
+                           (PATTERN_SIZE - 1);
+    return Counter::predict(patterns[context.patternIndex]);
+  }
+
+  void update(const PlanetInput &, const Context &context, bool outcome) {
+    Counter::update(patterns[context.patternIndex], outcome);
+    shiftLocalHistory(context.index, outcome);
+  }
+
+  void updateHistory(const PlanetInput &input, bool outcome) {
+    shiftLocalHistory(input.planetID & (SIZE - 1), outcome);
+  }
+
+ private:
+  static constexpr std::uint32_t HISTORY_MASK = (1u << HistoryBits) - 1;
+
+  // Costs 2 bitwise operations
+  void shiftLocalHistory(std::uint32_t index, bool outcome) {
+    LocalHistory &history = localHistories[index];
+    history = ((history << 1) | outcome) & HISTORY_MASK;
+  }
+
+  LocalHistory localHistories[SIZE] = {};
+  std::int8_t patterns[PATTERN_SIZE] = {};
+};
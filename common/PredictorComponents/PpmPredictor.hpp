@@ -0,0 +1,204 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// PPM predictor: a variable-order Markov model of the outcome sequence. For
+// every order k in Orders (increasing, 0 to 64) a table of 2^LogSize tagged
+// entries holds a 4-bit counter per context, the context being the k most
+// recent outcomes hashed with the planet ID. An entry packs a TagBits-bit tag
+// and the counter into 16 bits. The table of the first order is the base of
+// the model: its tags are ignored, so it always hits (usually Orders starts
+// with 0, making it a counter per planet).
+//
+// The prediction comes from the longest order whose context hits with a
+// confident counter (at least CONFIDENCE of 0 to 7 away from the boundary),
+// else from the longest order that hits.
+//
+// On update every hit counter is trained. A misprediction allocates the
+// context in the next order above the longest order that hits (not above
+// the provider, or a confident short order would keep the longer contexts
+// from ever being allocated), if the entry there is weak; a strong entry is
+// weakened instead, so contexts seen once don't evict established ones.
+//
+// Entries start empty: a weak counter and a marker in the top bit that no
+// tag matches (hence at most 11 tag bits), so no context hits a slot that
+// was never allocated, and the base table starts from weak counters.
+//
+// Contexts are hashed incrementally: the k most recent outcomes are kept
+// folded into LogSize + TagBits bits, and every outcome updates each folded
+// history in constant time (as in SpaceshipComputer). Orders that fit in the
+// folded width need no fold at all: they mask the global history.
+//
+// Storage: 2 * 2^LogSize bytes per order, 8 bytes per folded order and an
+// 8-byte history.
+// Cost per call: predict 1 additive, 6 bitwise per order, 1 or 2 more per
+// order with a history (see PREDICT_COST) and 2 more; update 1 additive and
+// 2 bitwise per order, 5 bitwise per folded order, 2 additive and 7 bitwise;
+// history update 5 bitwise per folded order and 1 more.
+
+#pragma once
+
+#include "PredictorComponents/PredictorComponent.hpp"
+
+template <int LogSize, int TagBits, int... Orders>
+class PpmPredictor {
+ public:
+  static constexpr int NUM_ORDERS = sizeof...(Orders);
+  static constexpr int ORDERS[NUM_ORDERS] = {Orders...};
+  static constexpr int FOLD_WIDTH = LogSize + TagBits;
+  static_assert(NUM_ORDERS >= 1, "No orders");
+  static_assert(LogSize >= 1 && LogSize <= 20, "Unsupported table size");
+  static_assert(TagBits >= 1 && TagBits <= 11, "Unsupported tag length");
+  static_assert(((Orders >= 0 && Orders <= 64) && ...),
+                "Unsupported order");
+  static constexpr std::uint32_t SIZE = 1u << LogSize;
+
+  static constexpr int NUM_FOLDED_ORDERS = ((Orders > FOLD_WIDTH) + ...);
+  static constexpr int NUM_FOLDED_HISTORIES =
+      NUM_FOLDED_ORDERS > 0 ? NUM_FOLDED_ORDERS : 1;
+
+  static constexpr std::size_t STORAGE_SIZE =
+      structSize<std::uint16_t[NUM_ORDERS][SIZE],
+                 std::uint64_t[NUM_FOLDED_HISTORIES], std::uint64_t>();
+  // Hashing a context xors the planet ID with the folded history of the
+  // order, or with the masked global history
+  static constexpr int CONTEXT_HASH_COST =
+      ((Orders > FOLD_WIDTH ? 1 : (Orders > 0 ? 2 : 0)) + ...);
+  // The tags of the first order are never compared
+  static constexpr ComponentCost PREDICT_COST = {
+      1, 0, 6 * NUM_ORDERS + CONTEXT_HASH_COST + 2};
+  static constexpr ComponentCost UPDATE_COST = {
+      NUM_ORDERS + 2, 0, 2 * NUM_ORDERS + 7 + 5 * NUM_FOLDED_ORDERS};
+  static constexpr ComponentCost HISTORY_UPDATE_COST = {
+      0, 0, 5 * NUM_FOLDED_ORDERS + 1};
+
+  // 4-bit counters: 8 to 15 predict true
+  static constexpr std::uint16_t COUNTER_MASK = 15;
+  static constexpr int CONFIDENCE = 2;
+  // Weak NIGHT counter and a tag that doesn't fit in TagBits
+  static constexpr std::uint16_t EMPTY_ENTRY = 0x8000 | 7;
+
+  PpmPredictor() {
+    for (auto &table : entries) {
+      for (std::uint16_t &entry : table) entry = EMPTY_ENTRY;
+    }
+  }
+
+  struct Context {
+    std::uint32_t indices[NUM_ORDERS];
+    std::uint16_t tags[NUM_ORDERS];
+    // Index of the order of the prediction and of the longest order that hits
+    int provider;
+    int longestHit;
+    bool isHit[NUM_ORDERS];
+    bool prediction;
+  };
+
+  ComponentPrediction predict(const PlanetInput &input, Context &context) {
+    int longestHit = 0;
+    int confidentProvider = -1;
+    forEachIndex<NUM_ORDERS>([&](auto order) {
+      constexpr int length = ORDERS[decltype(order)::value];
+      std::uint64_t key = input.planetID;
+      if constexpr (length > FOLD_WIDTH) {
+        key ^= foldedHistories[foldedIndex<order>()];
+      } else if constexpr (length > 0) {
+        key ^= history & orderMask<length>();
+      }
+      context.indices[order] = key & (SIZE - 1);
+      context.tags[order] = (key >> LogSize) & TAG_MASK;
+      std::uint16_t entry = entries[order][context.indices[order]];
+      context.isHit[order] =
+          order == 0 || (entry >> 4) == context.tags[order];
+      std::uint16_t counter = entry & COUNTER_MASK;
+      if (context.isHit[order]) {
+        longestHit = order;
+        if (counter >= 8 + CONFIDENCE || counter <= 7 - CONFIDENCE) {
+          confidentProvider = order;
+        }
+      }
+    });
+    context.longestHit = longestHit;
+    context.provider =
+        confidentProvider >= 0 ? confidentProvider : longestHit;
+    int counter =
+        entries[context.provider][context.indices[context.provider]] &
+        COUNTER_MASK;
+    context.prediction = counter >= 8;
+    return {context.prediction, true,
+            context.prediction ? counter - 8 : 7 - counter};
+  }
+
+  void update(const PlanetInput &input, const Context &context, bool outcome) {
+    forEachIndex<NUM_ORDERS>([&](auto order) {
+      if (context.isHit[order]) {
+        std::uint16_t &entry = entries[order][context.indices[order]];
+        std::uint16_t counter = entry & COUNTER_MASK;
+        if (outcome) {
+          if (counter < COUNTER_MASK) entry++;
+        } else {
+          if (counter > 0) entry--;
+        }
+      }
+    });
+    // The order above the longest hit misses by definition
+    int allocationOrder = context.longestHit + 1;
+    if (context.prediction != outcome && allocationOrder < NUM_ORDERS) {
+      std::uint16_t &entry =
+          entries[allocationOrder][context.indices[allocationOrder]];
+      std::uint16_t counter = entry & COUNTER_MASK;
+      if (counter == 7 || counter == 8) {
+        entry = (context.tags[allocationOrder] << 4) | (outcome ? 8 : 7);
+      } else if (counter > 8) {
+        entry--;
+      } else {
+        entry++;
+      }
+    }
+    updateHistory(input, outcome);
+  }
+
+  // The most recent Length outcomes folded into FOLD_WIDTH bits: the new
+  // outcome is shifted in and the outcome leaving the context cancelled, so
+  // the fold costs the same for every order
+  void updateHistory(const PlanetInput &, bool outcome) {
+    forEachIndex<NUM_ORDERS>([&](auto order) {
+      constexpr int length = ORDERS[decltype(order)::value];
+      if constexpr (length > FOLD_WIDTH) {
+        std::uint64_t &value = foldedHistories[foldedIndex<order>()];
+        std::uint64_t outgoingBit = (history >> (length - 1)) & 1;
+        value = (value << 1) | outcome;
+        value ^= outgoingBit << (length % FOLD_WIDTH);
+        value ^= value >> FOLD_WIDTH;
+        value &= orderMask<FOLD_WIDTH>();
+      }
+    });
+    history = (history << 1) | outcome;
+  }
+
+ private:
+  static constexpr std::uint64_t TAG_MASK = (1u << TagBits) - 1;
+
+  template <int Length>
+  static constexpr std::uint64_t orderMask() {
+    return Length >= 64 ? ~0ULL : (1ULL << Length) - 1;
+  }
+
+  // Position of a folded order among the folded orders
+  template <int Order>
+  static constexpr int foldedIndex() {
+    int index = 0;
+    for (int order = 0; order < Order; order++) {
+      index += ORDERS[order] > FOLD_WIDTH;
+    }
+    return index;
+  }
+
+  std::uint16_t entries[NUM_ORDERS][SIZE];
+  std::uint64_t foldedHistories[NUM_FOLDED_HISTORIES] = {};
+  std::uint64_t history = 0;
+};
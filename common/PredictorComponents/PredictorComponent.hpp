@@ -0,0 +1,163 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Definitions shared by the predictor components.
+//
+// Every component is a class template with
+//   struct Context - state carried from predict() to update() for one planet
+//   ComponentPrediction predict(const PlanetInput &input, Context &context)
+//   void update(const PlanetInput &input, const Context &context,
+//               bool outcome)
+//   void updateHistory(const PlanetInput &input, bool outcome) - shifts the
+//       outcome into the histories only, for a planet the component was not
+//       asked to predict (e.g. a skipped stage of EarlyExitPipeline)
+//   static constexpr std::size_t STORAGE_SIZE - sizeof the component
+//   static constexpr ComponentCost PREDICT_COST, UPDATE_COST,
+//       HISTORY_UPDATE_COST - upper bounds of the operations charged by the
+//       metric of computational cost per call
+// Components hold their state in fixed-size arrays, initialize it themselves
+// and can be placed directly into RoboMemory.
+//
+// The costs are counted from the operations of the code as compiled by the
+// task Makefiles (clang -O0): and/or/xor/ashr and compares (icmp/fcmp) are
+// bitwise, add/sub additive, mul/div/rem multiplicative, while shl/lshr,
+// casts, loads, stores, branches and calls are free. A branch on a bool
+// costs nothing, a branch on a comparison costs its compare. Optimization
+// only lowers them.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "DynamicInstructionCounting/DynamicInstructionCounting_Cost.hpp"
+
+// What a component knows about the next planet
+struct PlanetInput {
+  std::uint64_t planetID;
+  bool spaceshipPrediction;
+  // Group tag of the planet in task 2, 0 in task 1
+  int groupTag;
+};
+
+struct ComponentPrediction {
+  bool outcome;
+  // False if the component has no information about the planet (e.g. a tag
+  // miss); the outcome is then a default
+  bool isHit;
+  // Distance of the counter from the decision boundary: 0 is the weakest
+  // state. Comparable between components with counters of the same width.
+  int confidence;
+};
+
+// Number of operations of each category of the metric of computational cost
+struct ComponentCost {
+  int additive;
+  int multiplicative;
+  int bitwise;
+
+  constexpr int metric() const {
+    return additive * ADDITIVE_OP_COST +
+           multiplicative * MULTIPLICATIVE_OP_COST + bitwise * BITWISE_OP_COST;
+  }
+};
+
+constexpr ComponentCost operator+(const ComponentCost &a,
+                                  const ComponentCost &b) {
+  return {a.additive + b.additive, a.multiplicative + b.multiplicative,
+          a.bitwise + b.bitwise};
+}
+
+// Size of a struct with members of the given types in this order, so that
+// STORAGE_SIZE includes the padding of a component
+template <typename... Members>
+constexpr std::size_t structSize() {
+  std::size_t size = 0;
+  std::size_t alignment = 1;
+  ((size = (size + alignof(Members) - 1) / alignof(Members) * alignof(Members) +
+           sizeof(Members),
+    alignment = alignof(Members) > alignment ? alignof(Members) : alignment),
+   ...);
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// Total size of the components, to check RoboMemory against its budget at
+// compile time:
+//   static_assert(totalStorageSize<BimodalTable<12>, GshareTable<12, 12>>() <=
+//                 65536, "...");
+template <typename... Components>
+constexpr std::size_t totalStorageSize() {
+  static_assert(((sizeof(Components) == Components::STORAGE_SIZE) && ...),
+                "STORAGE_SIZE of a component doesn't match its size");
+  return (Components::STORAGE_SIZE + ... + 0);
+}
+
+// Calls f(std::integral_constant<int, I>()) for I = 0 .. N - 1. The calls are
+// unrolled at compile time, so even at -O0 no loop counter is charged.
+template <typename F, int... I>
+void forEachIndex(F &&f, std::integer_sequence<int, I...>) {
+  (f(std::integral_constant<int, I>()), ...);
+}
+
+template <int N, typename F>
+void forEachIndex(F &&f) {
+  forEachIndex(f, std::make_integer_sequence<int, N>());
+}
+
+// Signed saturating counters of Bits bits, stored in an int8_t: values in
+// [-2^(Bits-1), 2^(Bits-1) - 1], predicting true when non-negative
+template <int Bits>
+struct SaturatingCounter {
+  static_assert(Bits >= 1 && Bits <= 8, "Unsupported counter width");
+  static constexpr int MAX = (1 << (Bits - 1)) - 1;
+  static constexpr int MIN = -(1 << (Bits - 1));
+
+  // Costs 1 additive and 1 bitwise operation (the saturation compare)
+  static void update(std::int8_t &counter, bool outcome) {
+    if (outcome) {
+      if (counter < MAX) counter++;
+    } else {
+      if (counter > MIN) counter--;
+    }
+  }
+
+  // Counter of a newly allocated entry: the weakest state in the direction
+  // of the outcome
+  static std::int8_t weak(bool outcome) { return outcome ? 0 : -1; }
+
+  // Costs 3 bitwise operations: the sign compare, and c for c >= 0 and
+  // -c - 1 otherwise
+  static ComponentPrediction predict(std::int8_t counter, bool isHit = true) {
+    int value = counter;
+    return {value >= 0, isHit, value ^ (value >> 7)};
+  }
+};
+
+// Global history of the most recent Length outcomes, the newest in bit 0
+template <int Length>
+struct OutcomeHistory {
+  static_assert(Length >= 0 && Length <= 64, "Unsupported history length");
+  static constexpr std::uint64_t MASK =
+      Length == 64 ? ~0ULL : (1ULL << Length) - 1;
+
+  std::uint64_t value = 0;
+
+  // Costs 2 bitwise operations (1 for a 64-outcome history)
+  void update(bool outcome) {
+    if constexpr (Length == 64) {
+      value = (value << 1) | outcome;
+    } else if constexpr (Length > 0) {
+      value = ((value << 1) | outcome) & MASK;
+    }
+  }
+
+  static constexpr ComponentCost UPDATE_COST = {
+      0, 0, Length == 64 ? 1 : (Length > 0 ? 2 : 0)};
+};
@@ -0,0 +1,24 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Header-only library of predictor components (see README.md).
+
+#pragma once
+
+#include "PredictorComponents/BimodalTable.hpp"
+#include "PredictorComponents/Chooser.hpp"
+#include "PredictorComponents/EarlyExitPipeline.hpp"
+#include "PredictorComponents/GroupPredictor.hpp"
+#include "PredictorComponents/GshareTable.hpp"
+#include "PredictorComponents/HashedPerceptron.hpp"
+#include "PredictorComponents/LoopTable.hpp"
+#include "PredictorComponents/PeriodTable.hpp"
+#include "PredictorComponents/PpmPredictor.hpp"
+#include "PredictorComponents/PredictorComponent.hpp"
+#include "PredictorComponents/StatisticalCorrector.hpp"
+#include "PredictorComponents/TaggedTable.hpp"
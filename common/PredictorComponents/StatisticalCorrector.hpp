@@ -0,0 +1,198 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Statistical corrector (as in TAGE-SC-L): NumTables GEHL-style tables of
+// saturating counters that decide whether to override a primary prediction.
+// Every table is indexed by a hash of the planet ID, a slice of the global
+// outcome history of its own length (none in table 0, 4 << k outcomes in
+// table k) and a key of the primary prediction, a bucket of its confidence
+// and the prediction of the spaceship computer. The counters are summed, and
+// the primary prediction is overridden only if the sum disagrees with it by
+// at least the current threshold. The threshold adapts: it grows when
+// overrides turn out wrong and shrinks when they turn out right.
+//
+// A primary prediction with confidence of at least SkipConfidence (or a
+// miss, which the corrector can't judge) skips the corrector altogether:
+// neither its prediction nor its counters are computed, only its history is
+// updated.
+//
+// Corrected<Primary, Corrector> combines a component and a corrector into a
+// component with the usual interface.
+//
+// Storage: NumTables * 2^LogSize bytes, an 8-byte history and 8 bytes of
+// threshold state.
+// Cost per call (when not skipped): correct NumTables + 1 additive,
+// NumTables multiplicative and 3 * NumTables + 7 bitwise; update
+// NumTables + 2 additive and NumTables + 9 bitwise. A skipped call costs 1
+// bitwise in correct and 1 in update, as does a history update.
+
+#pragma once
+
+#include "PredictorComponents/PredictorComponent.hpp"
+
+template <int NumTables, int LogSize, int SkipConfidence, int CounterBits = 6>
+class StatisticalCorrector {
+ public:
+  static_assert(NumTables >= 1 && NumTables <= 5,
+                "Unsupported number of tables");
+  static_assert(LogSize >= 4 && LogSize <= 24, "Unsupported table size");
+  static constexpr std::uint32_t SIZE = 1u << LogSize;
+  static constexpr std::size_t STORAGE_SIZE =
+      structSize<std::int8_t[NumTables][SIZE], OutcomeHistory<64>,
+                 std::int32_t, std::int32_t>();
+  static constexpr ComponentCost CORRECT_COST = {NumTables + 1, NumTables,
+                                                 3 * NumTables + 7};
+  static constexpr ComponentCost UPDATE_COST =
+      ComponentCost{NumTables + 2, 0, NumTables + 8} +
+      OutcomeHistory<64>::UPDATE_COST;
+  static constexpr ComponentCost HISTORY_UPDATE_COST =
+      OutcomeHistory<64>::UPDATE_COST;
+
+  using Counter = SaturatingCounter<CounterBits>;
+
+  // Bounds of the override threshold and the width of the counter that
+  // adapts it
+  static constexpr int MIN_THRESHOLD = NumTables;
+  static constexpr int MAX_THRESHOLD = NumTables * Counter::MAX;
+  static constexpr int THRESHOLD_COUNTER_MAX = 31;
+
+  struct Context {
+    std::uint32_t indices[NumTables];
+    // Distance of the sum from the decision boundary
+    int magnitude;
+    bool isSkipped;
+    bool primaryOutcome;
+    bool correctorOutcome;
+  };
+
+  // Returns the primary prediction or its override
+  ComponentPrediction correct(const PlanetInput &input, Context &context,
+                              const ComponentPrediction &primary) {
+    context.isSkipped = !primary.isHit || primary.confidence >= SkipConfidence;
+    context.primaryOutcome = primary.outcome;
+    if (context.isSkipped) return primary;
+
+    // The key is xored into the 4 low bits of the indices
+    std::uint32_t confidenceBucket =
+        primary.confidence < 1 ? 0 : (primary.confidence < 3 ? 1 : 2);
+    std::uint32_t key = (confidenceBucket << 2) |
+                        ((std::uint32_t)input.spaceshipPrediction << 1) |
+                        primary.outcome;
+    // Counters are centered between -1 and 0: the sum of c + 1/2 rounded down
+    int sum = NumTables / 2;
+    forEachIndex<NumTables>([&](auto table) {
+      context.indices[table] = tableIndex<table>(input) ^ key;
+      sum += counters[table][context.indices[table]];
+    });
+    context.correctorOutcome = sum >= 0;
+    context.magnitude = sum >= 0 ? sum : -sum;
+    if (context.correctorOutcome != primary.outcome &&
+        context.magnitude >= threshold) {
+      return {context.correctorOutcome, true, 0};
+    }
+    return primary;
+  }
+
+  void update(const PlanetInput &, const Context &context, bool outcome) {
+    if (!context.isSkipped) {
+      if (context.correctorOutcome != context.primaryOutcome &&
+          context.magnitude >= threshold) {
+        adaptThreshold(context.correctorOutcome == outcome);
+      }
+      // GEHL training: on a wrong sum or a sum close to the boundary
+      if (context.correctorOutcome != outcome ||
+          context.magnitude < threshold) {
+        forEachIndex<NumTables>([&](auto table) {
+          Counter::update(counters[table][context.indices[table]], outcome);
+        });
+      }
+    }
+    history.update(outcome);
+  }
+
+  void updateHistory(const PlanetInput &, bool outcome) {
+    history.update(outcome);
+  }
+
+ private:
+  static constexpr std::uint64_t GOLDEN_RATIO = 0x9e3779b97f4a7c15ULL;
+
+  template <int Table>
+  static constexpr std::uint64_t historyMask() {
+    constexpr int length = Table == 0 ? 0 : 4 << Table;
+    return length >= 64 ? ~0ULL : (1ULL << length) - 1;
+  }
+
+  template <int Table>
+  std::uint32_t tableIndex(const PlanetInput &input) const {
+    if constexpr (Table == 0) {
+      return (input.planetID * GOLDEN_RATIO) >> (64 - LogSize);
+    } else {
+      return ((input.planetID ^ (history.value & historyMask<Table>())) *
+              GOLDEN_RATIO) >>
+             (64 - LogSize);
+    }
+  }
+
+  // Costs at most 2 additive and 3 bitwise operations
+  void adaptThreshold(bool wasOverrideCorrect) {
+    if (wasOverrideCorrect) {
+      thresholdCounter--;
+    } else {
+      thresholdCounter++;
+    }
+    if (thresholdCounter > THRESHOLD_COUNTER_MAX) {
+      if (threshold < MAX_THRESHOLD) threshold++;
+      thresholdCounter = 0;
+    } else if (thresholdCounter < -THRESHOLD_COUNTER_MAX) {
+      if (threshold > MIN_THRESHOLD) threshold--;
+      thresholdCounter = 0;
+    }
+  }
+
+  std::int8_t counters[NumTables][SIZE] = {};
+  OutcomeHistory<64> history;
+  std::int32_t threshold = 2 * NumTables;
+  std::int32_t thresholdCounter = 0;
+};
+
+template <typename Primary, typename Corrector>
+class Corrected {
+ public:
+  static constexpr std::size_t STORAGE_SIZE = structSize<Primary, Corrector>();
+  static constexpr ComponentCost PREDICT_COST =
+      Primary::PREDICT_COST + Corrector::CORRECT_COST;
+  static constexpr ComponentCost UPDATE_COST =
+      Primary::UPDATE_COST + Corrector::UPDATE_COST;
+  static constexpr ComponentCost HISTORY_UPDATE_COST =
+      Primary::HISTORY_UPDATE_COST + Corrector::HISTORY_UPDATE_COST;
+
+  struct Context {
+    typename Primary::Context primary;
+    typename Corrector::Context corrector;
+  };
+
+  ComponentPrediction predict(const PlanetInput &input, Context &context) {
+    return corrector.correct(input, context.corrector,
+                             primary.predict(input, context.primary));
+  }
+
+  void update(const PlanetInput &input, const Context &context, bool outcome) {
+    primary.update(input, context.primary, outcome);
+    corrector.update(input, context.corrector, outcome);
+  }
+
+  void updateHistory(const PlanetInput &input, bool outcome) {
+    primary.updateHistory(input, outcome);
+    corrector.updateHistory(input, outcome);
+  }
+
+ private:
+  Primary primary;
+  Corrector corrector;
+};
@@ -0,0 +1,343 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Benchmark of the predictor components.
+//
+// Runs every component on its own over a route, with the predictions of the
+// original spaceship computer as hints, and reports its storage, its accuracy
+// and the cost of its predict() and update() calls: the average and the
+// maximum measured per call by dynamic instruction counting, next to the
+// documented upper bound (PREDICT_COST, UPDATE_COST). The costs are only
+// measured when the benchmark is built with the counting plugin (see
+// Makefile).
+//
+// Early-exit pipelines are also reported against the evaluation of all their
+// stages: the distribution of the stage they exit at and the average, 90th
+// and 99th percentile and maximum of their cost per planet, with the
+// reduction against the full pipeline. These costs are measured like the
+// components' (measureCall) over the predict() and update() calls of each
+// planet, so they include the pipeline's own compares. Only the native build
+// (DYN_INSTR_COUNT_NATIVE), which measures nothing, adds up the documented
+// bounds of the stages evaluated and trained for every planet instead.
+//
+// Last, a planet repeating a sequence of 37 outcomes checks that the
+// components with histories learn it: a misprediction after the warm-up
+// fails the benchmark.
+//
+// Usage: ./componentBenchmark <route file> [--atlas]
+// --atlas reads a task 2 route with group tags.
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "DynamicInstructionCounting/DynamicInstructionCounting_API.hpp"
+#include "PredictorComponents/PredictorComponents.hpp"
+#include "Route.hpp"
+#include "SpaceshipComputer/SpaceshipComputer.hpp"
+
+struct BenchmarkPlanet {
+  PlanetInput input;
+  bool timeOfDay;
+};
+
+// Cost of the calls of one function
+struct CallCostStatistics {
+  std::vector<int64_t> metrics;
+  int64_t totalMetric = 0;
+  int64_t maxMetric = 0;
+
+  void record(int64_t metric) {
+    metrics.push_back(metric);
+    totalMetric += metric;
+    if (metric > maxMetric) maxMetric = metric;
+  }
+
+  void record(int64_t additive, int64_t multiplicative, int64_t bitwise) {
+    record(computeComputationalCost(additive, multiplicative, bitwise));
+  }
+
+  double average() const {
+    return metrics.empty() ? 0 : (double)totalMetric / metrics.size();
+  }
+
+  int64_t percentile(double fraction) {
+    if (metrics.empty()) return 0;
+    auto nth = metrics.begin() + (size_t)(fraction * (metrics.size() - 1));
+    std::nth_element(metrics.begin(), nth, metrics.end());
+    return *nth;
+  }
+};
+
+// Counts the instructions of f() alone
+template <typename F>
+void measureCall(CallCostStatistics &statistics, F &&f) {
+  int64_t additive = additiveInstructionCounter;
+  int64_t multiplicative = multiplicativeInstructionCounter;
+  int64_t bitwise = bitwiseInstructionCounter;
+  enableDynamicInstructionCounting();
+  f();
+  disableDynamicInstructionCounting();
+  statistics.record(additiveInstructionCounter - additive,
+                    multiplicativeInstructionCounter - multiplicative,
+                    bitwiseInstructionCounter - bitwise);
+}
+
+// Baseline that follows the spaceship computer
+struct FollowSpaceshipComputer {
+  static constexpr std::size_t STORAGE_SIZE = 0;
+  static constexpr ComponentCost PREDICT_COST = {0, 0, 0};
+  static constexpr ComponentCost UPDATE_COST = {0, 0, 0};
+  static constexpr ComponentCost HISTORY_UPDATE_COST = {0, 0, 0};
+
+  struct Context {};
+
+  ComponentPrediction predict(const PlanetInput &input, Context &) {
+    return {input.spaceshipPrediction, true, 0};
+  }
+
+  void update(const PlanetInput &, const Context &, bool) {}
+
+  void updateHistory(const PlanetInput &, bool) {}
+};
+
+template <typename Component>
+void benchmarkComponent(const char *name,
+                        const std::vector<BenchmarkPlanet> &planets) {
+  // Components can be larger than the stack
+  static Component component;
+  CallCostStatistics predictCost;
+  CallCostStatistics updateCost;
+  uint64_t numberOfCorrectPredictions = 0;
+  for (const BenchmarkPlanet &planet : planets) {
+    typename Component::Context context{};
+    ComponentPrediction prediction;
+    measureCall(predictCost, [&] {
+      prediction = component.predict(planet.input, context);
+    });
+    measureCall(updateCost, [&] {
+      component.update(planet.input, context, planet.timeOfDay);
+    });
+    numberOfCorrectPredictions += prediction.outcome == planet.timeOfDay;
+  }
+  printf("%-30s %8zu %8.2f%% %8.1f %6ld %6d %8.1f %6ld %6d\n", name,
+         Component::STORAGE_SIZE,
+         100.0 * numberOfCorrectPredictions / planets.size(),
+         predictCost.average(), predictCost.maxMetric,
+         Component::PREDICT_COST.metric(), updateCost.average(),
+         updateCost.maxMetric, Component::UPDATE_COST.metric());
+}
+
+// The same stages without early exit
+template <typename Pipeline>
+struct WithoutEarlyExit;
+
+template <typename... Stages>
+struct WithoutEarlyExit<StagePipeline<true, Stages...>> {
+  using type = FullPipeline<Stages...>;
+};
+
+// Metric per planet of a pipeline
+struct PipelineCost {
+  double average;
+  int64_t p90;
+  int64_t p99;
+  int64_t max;
+};
+
+// Accuracy and cost per planet of a pipeline, with its reduction from the
+// reference (none for the reference itself)
+template <typename Pipeline>
+PipelineCost runPipeline(const char *name,
+                         const std::vector<BenchmarkPlanet> &planets,
+                         std::vector<int64_t> &exits,
+                         const PipelineCost *reference) {
+  static Pipeline pipeline;
+  CallCostStatistics statistics;
+  uint64_t numberOfCorrectPredictions = 0;
+  for (const BenchmarkPlanet &planet : planets) {
+    typename Pipeline::Context context{};
+    ComponentPrediction prediction;
+    auto call = [&] {
+      prediction = pipeline.predict(planet.input, context);
+      pipeline.update(planet.input, context, planet.timeOfDay);
+    };
+#ifdef DYN_INSTR_COUNT_NATIVE
+    call();
+    statistics.record(
+        Pipeline::callCost(context, planet.timeOfDay).metric());
+#else
+    measureCall(statistics, call);
+#endif
+    numberOfCorrectPredictions += prediction.outcome == planet.timeOfDay;
+    exits[context.numEvaluated - 1]++;
+  }
+  PipelineCost cost = {statistics.average(), statistics.percentile(0.9),
+                       statistics.percentile(0.99), statistics.maxMetric};
+  if (reference == nullptr) reference = &cost;
+  printf("%-30s %8.2f%% %6.1f (%5.1f%%) %4ld (%5.1f%%) %4ld (%5.1f%%) %4ld "
+         "(%5.1f%%)\n",
+         name, 100.0 * numberOfCorrectPredictions / planets.size(),
+         cost.average, 100.0 * (1 - cost.average / reference->average),
+         cost.p90, 100.0 * (1 - (double)cost.p90 / reference->p90), cost.p99,
+         100.0 * (1 - (double)cost.p99 / reference->p99), cost.max,
+         100.0 * (1 - (double)cost.max / reference->max));
+  return cost;
+}
+
+// Reports the early exits of a pipeline and its cost per planet (predict()
+// and update()) against the evaluation of all its stages
+template <typename Pipeline>
+void benchmarkPipeline(const char *name,
+                       const std::vector<BenchmarkPlanet> &planets) {
+  using Reference = typename WithoutEarlyExit<Pipeline>::type;
+  std::vector<int64_t> exits(Pipeline::NUM_STAGES);
+  std::vector<int64_t> fullExits(Pipeline::NUM_STAGES);
+#ifdef DYN_INSTR_COUNT_NATIVE
+  printf("\n%s: metric per planet from the bounds of the stages run, and its "
+         "reduction\n",
+         name);
+#else
+  printf("\n%s: measured metric per planet, and its reduction\n", name);
+#endif
+  printf("%-30s %9s %15s %13s %13s %13s\n", "", "accuracy", "average",
+         "p90", "p99", "max");
+  PipelineCost fullCost =
+      runPipeline<Reference>("all stages", planets, fullExits, nullptr);
+  runPipeline<Pipeline>("early exit", planets, exits, &fullCost);
+  printf("Planets per number of stages evaluated:");
+  for (int i = 0; i < Pipeline::NUM_STAGES; i++) {
+    printf(" %d: %.2f%%", i + 1, 100.0 * exits[i] / planets.size());
+  }
+  printf("\n");
+}
+
+// A component with long enough histories learns a planet that repeats a
+// sequence of outcomes: it must make no mispredictions after the warm-up
+template <typename Component>
+bool checkRepeatedSequence(const char *name) {
+  constexpr int PERIOD = 37;
+  constexpr int NUM_VISITS = 40000;
+  constexpr int NUM_CHECKED_VISITS = 100 * PERIOD;
+  static Component component;
+  // A fixed pseudo-random sequence (xorshift)
+  bool sequence[PERIOD];
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  for (bool &outcome : sequence) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    outcome = state & 1;
+  }
+  int numberOfMispredictions = 0;
+  for (int visit = 0; visit < NUM_VISITS; visit++) {
+    PlanetInput input = {4242, false, 0};
+    typename Component::Context context{};
+    bool outcome = sequence[visit % PERIOD];
+    bool prediction = component.predict(input, context).outcome;
+    if (visit >= NUM_VISITS - NUM_CHECKED_VISITS) {
+      numberOfMispredictions += prediction != outcome;
+    }
+    component.update(input, context, outcome);
+  }
+  printf("%-30s %5d of %d\n", name, numberOfMispredictions,
+         NUM_CHECKED_VISITS);
+  return numberOfMispredictions == 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <route file> [--atlas]"
+              << std::endl;
+    return 1;
+  }
+  std::string routeFile = argv[1];
+  bool isAtlas = argc > 2 && strcmp(argv[2], "--atlas") == 0;
+
+  // Read the route and the hints of the spaceship computer once
+  Route route(routeFile);
+  SpaceshipComputer<> spaceshipComputer;
+  std::vector<BenchmarkPlanet> planets;
+  planets.reserve(route.getTotalNumberOfPlanets());
+  PlanetInfo planet = {};
+  while (isAtlas ? route.readLineFromAtlasFile(planet)
+                 : route.readLineFromFile(planet)) {
+    bool hint = spaceshipComputer.predict(planet.planetID);
+    spaceshipComputer.update(planet.planetID, planet.timeOfDay);
+    int groupTag = isAtlas ? planet.planetGroupTag : 0;
+    planets.push_back({{planet.planetID, hint, groupTag}, planet.timeOfDay});
+  }
+  if (planets.empty()) {
+    std::cerr << "No planets in " << routeFile << std::endl;
+    return 1;
+  }
+
+  printf("%zu planets of %s\n", planets.size(), routeFile.c_str());
+  printf("%-30s %8s %9s %24s %24s\n", "", "", "",
+         "predict metric per call", "update metric per call");
+  printf("%-30s %8s %9s %8s %6s %6s %8s %6s %6s\n", "component", "bytes",
+         "accuracy", "average", "max", "bound", "average", "max", "bound");
+  benchmarkComponent<FollowSpaceshipComputer>("follow spaceship computer",
+                                              planets);
+  benchmarkComponent<BimodalTable<14>>("BimodalTable<14>", planets);
+  benchmarkComponent<GshareTable<14, 14>>("GshareTable<14, 14>", planets);
+  benchmarkComponent<TaggedTable<12, 10, 8>>("TaggedTable<12, 10, 8>",
+                                             planets);
+  benchmarkComponent<PeriodTable<12, 8, 14>>("PeriodTable<12, 8, 14>",
+                                             planets);
+  benchmarkComponent<LoopTable<12>>("LoopTable<12>", planets);
+  benchmarkComponent<HashedPerceptron<4, 8>>("HashedPerceptron<4, 8>",
+                                             planets);
+  benchmarkComponent<HashedPerceptron<8, 7>>("HashedPerceptron<8, 7>",
+                                             planets);
+  benchmarkComponent<Tournament<BimodalTable<12>, PeriodTable<12, 8, 14>, 12>>(
+      "Tournament<Bimodal, Period>", planets);
+  benchmarkComponent<Tournament<BimodalTable<12>, LoopTable<12>, 12>>(
+      "Tournament<Bimodal, Loop>", planets);
+  benchmarkComponent<
+      Corrected<BimodalTable<14>, StatisticalCorrector<4, 10, 2>>>(
+      "Corrected<Bimodal, SC>", planets);
+  benchmarkComponent<
+      Corrected<GshareTable<14, 14>, StatisticalCorrector<4, 10, 2>>>(
+      "Corrected<Gshare, SC>", planets);
+  benchmarkComponent<PpmPredictor<11, 11, 0, 2, 4, 8, 12, 16, 24, 32>>(
+      "PpmPredictor<11, 11, 8 orders>", planets);
+  // Group tag components, meant for task 2 routes (--atlas)
+  benchmarkComponent<GroupPredictor<BimodalTable<12>, 12>>(
+      "GroupPredictor<Bimodal, 12>", planets);
+  benchmarkComponent<GroupPredictor<PeriodTable<12, 8, 14>, 12>>(
+      "GroupPredictor<Period, 12>", planets);
+  // Evaluated as Period, Loop, HashedPerceptron (cheapest first)
+  using Pipeline = EarlyExitPipeline<Stage<HashedPerceptron<4, 8>, 0>,
+                                     Stage<LoopTable<12>, 3>,
+                                     Stage<PeriodTable<12, 8, 14, 3>, 2>>;
+  benchmarkComponent<Pipeline>("EarlyExitPipeline", planets);
+#ifdef DYN_INSTR_COUNT_NATIVE
+  printf("The metric of computational cost is not measured by the native "
+         "build\n");
+#endif
+  benchmarkPipeline<Pipeline>(
+      "EarlyExitPipeline<Period, Loop, HashedPerceptron>", planets);
+
+  printf("\nMispredictions of a planet repeating 37 outcomes, after warm-up\n");
+  bool isLearned = true;
+  isLearned &= checkRepeatedSequence<GshareTable<14, 14>>(
+      "GshareTable<14, 14>");
+  isLearned &= checkRepeatedSequence<HashedPerceptron<4, 8>>(
+      "HashedPerceptron<4, 8>");
+  isLearned &= checkRepeatedSequence<
+      PpmPredictor<11, 11, 0, 2, 4, 8, 12, 16, 24, 32>>(
+      "PpmPredictor<11, 11, 8 orders>");
+  if (!isLearned) {
+    std::cerr << "A component did not learn the repeated sequence"
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Opt-in prediction context for Robo.
+//
+// A prediction algorithm that computes the same hashes in both
+// predictTimeOfDayOnNextPlanet() and observeAndRecordTimeofdayOnNextPlanet()
+// can compute them once and carry them from one call to the other. To opt in,
+// declare a small context struct inside RoboPredictor and overloads taking it
+// as the last argument:
+//
+//   struct RoboPredictor {
+//     struct PredictionContext { std::uint32_t index; std::uint16_t tag; };
+//     bool predictTimeOfDayOnNextPlanet(std::uint64_t nextPlanetID,
+//                                       bool spaceshipComuterPrediction,
+//                                       PredictionContext &context);
+//     void observeAndRecordTimeofdayOnNextPlanet(
+//         std::uint64_t nextPlanetID, bool timeOfDayOnNextPlanet,
+//         const PredictionContext &context);
+//     ...
+//   };
+//
+// (in task 2, the group tag precedes the context in the prediction call).
+// The driver loop creates a fresh context for every planet outside of the
+// counting window and passes it to both calls. Without a context the original
+// functions are called.
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+template <typename Predictor, typename = void>
+struct HasPredictionContext : std::false_type {};
+
+template <typename Predictor>
+struct HasPredictionContext<Predictor,
+                            std::void_t<typename Predictor::PredictionContext>>
+    : std::true_type {};
+
+struct NoRoboPredictionContext {};
+
+template <typename Predictor, bool = HasPredictionContext<Predictor>::value>
+struct RoboPredictionContextOf {
+  using type = NoRoboPredictionContext;
+};
+
+template <typename Predictor>
+struct RoboPredictionContextOf<Predictor, true> {
+  using type = typename Predictor::PredictionContext;
+};
+
+template <typename Predictor>
+using RoboPredictionContext = typename RoboPredictionContextOf<Predictor>::type;
+
+// The context lives on the stack of the driver loop and is passed by reference
+// through both calls, so it must stay small
+const int MAX_ROBO_PREDICTION_CONTEXT_SIZE = 256;
+
+template <typename Predictor, typename... Args>
+bool predictTimeOfDayWithContext(Predictor &predictor,
+                                 RoboPredictionContext<Predictor> &context,
+                                 Args... args) {
+  static_assert(sizeof(context) <= MAX_ROBO_PREDICTION_CONTEXT_SIZE,
+                "Robo's prediction context is too large");
+  if constexpr (HasPredictionContext<Predictor>::value) {
+    return predictor.predictTimeOfDayOnNextPlanet(args..., context);
+  } else {
+    (void)context;
+    return predictor.predictTimeOfDayOnNextPlanet(args...);
+  }
+}
+
+template <typename Predictor>
+void observeAndRecordTimeofdayWithContext(
+    Predictor &predictor, const RoboPredictionContext<Predictor> &context,
+    std::uint64_t nextPlanetID, bool timeOfDayOnNextPlanet) {
+  if constexpr (HasPredictionContext<Predictor>::value) {
+    predictor.observeAndRecordTimeofdayOnNextPlanet(
+        nextPlanetID, timeOfDayOnNextPlanet, context);
+  } else {
+    (void)context;
+    predictor.observeAndRecordTimeofdayOnNextPlanet(nextPlanetID,
+                                                    timeOfDayOnNextPlanet);
+  }
+}
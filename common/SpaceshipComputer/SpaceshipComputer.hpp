@@ -8,9 +8,15 @@
 
 #include <limits.h> /* CHAR_BIT */
 
-#include <cmath>
-#include <iostream>
-#include <vector>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -24,141 +30,579 @@ const int NUM_HISTORY_TABLES = 1;  // Number of history tables
 const int TAG_LENGTH = 12;         // Maximum tag length
 const int MAX_CONFIDENCE = 3;      // Maximum confidence counter value
 
+// Configurations of the spaceship computer are structs with static constexpr
+// members:
+//   numTables        - number of tagged tables
+//   logTableSize     - log2 of the number of entries of every table
+//   associativity    - ways per set: 1 (direct-mapped), 2, 4, 8 or 16
+//   minHistoryLength - history length of table 1
+//   maxHistoryLength - history length of the last table
+//   minTagLength     - tag length of table 0
+//   maxTagLength     - tag length of the last table
+//   isTagAboveIndex  - table 0 takes its tag from the planet ID bits above
+//                      the set index; otherwise from the low bits, like the
+//                      original spaceship computer, where the tag repeats
+//                      the index
+//   isEmptyWayMarked - empty ways hold a tag that no planet gets, so they
+//                      never hit; otherwise they start zeroed and hit tag 0,
+//                      like in the original spaceship computer
+//   counterBits      - width of the confidence counters
+//   usefulBits       - width of the useful counters (0 disables them)
+//   usefulAgingPeriod - number of updates between two agings of the useful
+//                      counters
+//   storageBudget    - upper bound of sizeof(SpaceshipComputer<Config>)
+// Table 0 is indexed and tagged by the planet ID alone. Tables 1 to
+// numTables - 1 also hash the most recent outcomes, with history lengths
+// growing geometrically from minHistoryLength to maxHistoryLength. Tag lengths
+// grow linearly from minTagLength to maxTagLength.
+// In set-associative tables a tag may live in any way of its set. All tags of
+// a set are compared at once with SSE2 (up to 8 ways) or AVX2 (16 ways). A new
+// tag replaces the way with the weakest counter, the least recently used one
+// among equally weak ways.
+// With useful counters (as in TAGE), an entry becomes more useful when it
+// provides a correct prediction that its alternate would have got wrong, and
+// less useful in the opposite case. A misprediction allocates one entry in
+// the first table above the provider that has a non-useful entry; if no such
+// entry exists, the candidate entries lose usefulness instead. Every
+// usefulAgingPeriod updates all useful counters are decremented, so entries
+// that stopped being useful are eventually replaced.
+
+// The spaceship computer of the challenge: one table of 4096 entries
+struct OriginalSpaceshipComputerConfig {
+  static constexpr int numTables = NUM_HISTORY_TABLES;
+  static constexpr int logTableSize = 12;
+  static constexpr int associativity = 1;
+  static constexpr int minHistoryLength = 0;
+  static constexpr int maxHistoryLength = 0;
+  static constexpr int minTagLength = TAG_LENGTH;
+  static constexpr int maxTagLength = TAG_LENGTH;
+  static constexpr bool isTagAboveIndex = false;
+  static constexpr bool isEmptyWayMarked = false;
+  static constexpr int counterBits = 2;
+  static constexpr int usefulBits = 0;
+  static constexpr int usefulAgingPeriod = 0;
+  static constexpr size_t storageBudget = 16 * 1024;
+};
+
+static_assert((1 << OriginalSpaceshipComputerConfig::logTableSize) ==
+                      MAX_HISTORY_TABLE_SIZE &&
+                  (1 << OriginalSpaceshipComputerConfig::counterBits) - 1 ==
+                      MAX_CONFIDENCE,
+              "The original spaceship computer must match its constants");
+
+// A TAGE-style reference predictor with 8 tables and histories of up to 256
+// outcomes
+struct TageSpaceshipComputerConfig {
+  static constexpr int numTables = 8;
+  static constexpr int logTableSize = 10;
+  static constexpr int associativity = 1;
+  static constexpr int minHistoryLength = 4;
+  static constexpr int maxHistoryLength = 256;
+  static constexpr int minTagLength = 8;
+  static constexpr int maxTagLength = 13;
+  static constexpr bool isTagAboveIndex = true;
+  static constexpr bool isEmptyWayMarked = true;
+  static constexpr int counterBits = 2;
+  static constexpr int usefulBits = 1;
+  static constexpr int usefulAgingPeriod = 1 << 16;
+  static constexpr size_t storageBudget = 32 * 1024;
+};
+
+// The same predictor with 4-way and 8-way set-associative tables
+struct Tage4WaySpaceshipComputerConfig : TageSpaceshipComputerConfig {
+  static constexpr int associativity = 4;
+  static constexpr size_t storageBudget = 48 * 1024;
+};
+
+struct Tage8WaySpaceshipComputerConfig : TageSpaceshipComputerConfig {
+  static constexpr int associativity = 8;
+  static constexpr size_t storageBudget = 48 * 1024;
+};
+
+// Compile-time helpers of the spaceship computer
+namespace spaceship_computer_detail {
+
+constexpr double power(double base, int exponent) {
+  double result = 1.0;
+  for (int i = 0; i < exponent; i++) result *= base;
+  return result;
+}
+
+// n-th root of x >= 1 with Newton's method
+constexpr double root(double x, int n) {
+  double y = x;
+  for (int i = 0; i < 200; i++) {
+    y -= (power(y, n) - x) / (n * power(y, n - 1));
+  }
+  return y;
+}
+
+constexpr int log2(int value) {
+  int result = 0;
+  while ((1 << result) < value) result++;
+  return result;
+}
+
+constexpr int nextPowerOfTwo(int value) {
+  int result = 1;
+  while (result < value) result <<= 1;
+  return result;
+}
+
+// Calls f(integral_constant<int, I>()) for every I of the sequence. The calls
+// are unrolled at compile time.
+template <typename F, int... I>
+void forEach(F &&f, integer_sequence<int, I...>) {
+  (f(integral_constant<int, I>()), ...);
+}
+
+// Same in the reverse order, stopping after the first call that returns true
+template <int N, typename F, int... I>
+void forEachReversedUntil(F &&f, integer_sequence<int, I...>) {
+  (f(integral_constant<int, N - 1 - I>()) || ...);
+}
+
+}  // namespace spaceship_computer_detail
+
+template <typename Config = OriginalSpaceshipComputerConfig>
 class SpaceshipComputer {
  public:
-  SpaceshipComputer() { initializeTables(); }
+  static constexpr int NUM_TABLES = Config::numTables;
+  static constexpr int LOG_TABLE_SIZE = Config::logTableSize;
+  static constexpr uint32_t TABLE_SIZE = 1u << LOG_TABLE_SIZE;
+  static constexpr int ASSOCIATIVITY = Config::associativity;
+  static constexpr int LOG_NUM_SETS =
+      LOG_TABLE_SIZE - spaceship_computer_detail::log2(ASSOCIATIVITY);
+  static constexpr uint32_t SET_MASK = (1u << LOG_NUM_SETS) - 1;
+  static constexpr int COUNTER_BITS = Config::counterBits;
+  static constexpr int MAX_COUNTER = (1 << COUNTER_BITS) - 1;
+  static constexpr int USEFUL_BITS = Config::usefulBits;
+  static constexpr int MAX_USEFUL = (1 << USEFUL_BITS) - 1;
+  // A table entry is packed into 16 bits: the tag above the useful counter
+  // above the confidence counter
+  static constexpr int TAG_SHIFT = COUNTER_BITS + USEFUL_BITS;
+  static constexpr int MAX_PACKED_TAG_LENGTH = 16 - TAG_SHIFT;
+  // Tag of the empty ways: all ones. Planets of tables with tags of full
+  // width that hash to it get another tag.
+  static constexpr uint16_t EMPTY_TAG = (1u << MAX_PACKED_TAG_LENGTH) - 1;
 
-  // Predict the outcome
-  bool predict(uint64_t planetID) {
-    // Compute tag and index for each table
-    uint64_t tags[NUM_HISTORY_TABLES];
-    uint64_t indices[NUM_HISTORY_TABLES];
-
-    for (int table_num = 0; table_num < NUM_HISTORY_TABLES; table_num++) {
-      int tableSize = MAX_HISTORY_TABLE_SIZE >> table_num;
-      BIT_MASK(uint64_t, TAG_LENGTH);
-      indices[table_num] =
-          (planetID ^
-           (ghist &
-            ((table_num > 0) ? BIT_MASK(uint64_t, (1 << table_num)) : 0))) %
-          tableSize;
-      tags[table_num] =
-          (planetID ^
-           (ghist &
-            ((table_num > 0) ? BIT_MASK(uint64_t, (1 << table_num)) : 0))) &
-          BIT_MASK(uint64_t, TAG_LENGTH);
-    }
-
-    // Perform predictions and compute the final prediction
-    bool final_prediction = false;
-    bool found = false;
+  static_assert(NUM_TABLES >= 1, "At least one table is required");
+  static_assert(LOG_TABLE_SIZE >= 1 && LOG_TABLE_SIZE <= 24,
+                "Unsupported table size");
+  static_assert(ASSOCIATIVITY == 1 || ASSOCIATIVITY == 2 ||
+                    ASSOCIATIVITY == 4 || ASSOCIATIVITY == 8 ||
+                    ASSOCIATIVITY == 16,
+                "Unsupported associativity");
+  static_assert(LOG_NUM_SETS >= 1, "A table needs at least two sets");
+  static_assert(COUNTER_BITS >= 1 && COUNTER_BITS <= 8,
+                "Unsupported counter width");
+  static_assert(USEFUL_BITS >= 0 && USEFUL_BITS <= 2 &&
+                    (USEFUL_BITS == 0 || Config::usefulAgingPeriod > 0),
+                "Unsupported useful counters");
+  static_assert(Config::minTagLength >= 1 &&
+                    Config::minTagLength <= Config::maxTagLength,
+                "Unsupported tag lengths");
+  static_assert(Config::maxTagLength <= MAX_PACKED_TAG_LENGTH,
+                "Tag and counters do not fit into a 16-bit table entry");
+  static_assert(NUM_TABLES == 1 ||
+                    (Config::minHistoryLength >= 1 &&
+                     Config::minHistoryLength <= Config::maxHistoryLength),
+                "Unsupported history lengths");
 
-    for (int i = 0; i < NUM_HISTORY_TABLES; i++) {
-      if (tables[i][indices[i]].tag == tags[i]) {
-        int confidence = tables[i][indices[i]].counter;
-        if (confidence >= (MAX_CONFIDENCE + 1) / 2) {
-          final_prediction = true;
-        }
-        num_of_table_given_prev_prediction = i;
-        prev_prediction = final_prediction;
-        found = true;
-        break;
+  SpaceshipComputer() {
+    static_assert(sizeof(SpaceshipComputer) <= Config::storageBudget,
+                  "Spaceship computer exceeds the storage budget of its "
+                  "configuration");
+    if constexpr (Config::isEmptyWayMarked) {
+      for (uint16_t &entry : entries) {
+        entry = packEntry(EMPTY_TAG, newCounter(false));
       }
     }
-    if (!found) num_of_table_given_prev_prediction = -1;
+  }
+
+  // State carried from the prediction for a planet to the update with its
+  // outcome: the indices and tags are hashed once per planet
+  struct PredictionContext {
+    uint64_t planetID;
+    // Position of the first entry of the set of every table
+    uint32_t indices[NUM_TABLES];
+    uint16_t tags[NUM_TABLES];
+    // Table that provided the prediction, -1 if no table holds the tag, and
+    // the way of its set holding the tag
+    int provider;
+    int providerWay;
+    // Next table holding the tag below the provider, -1 if none does. Only
+    // searched for when the provider is weak or useful counters are enabled.
+    int alternate;
+    bool providerPrediction;
+    bool alternatePrediction;
+    bool prediction;
+  };
+
+  // Predict the outcome
+  bool predict(uint64_t planetID) { return predict(planetID, lastContext); }
+
+  bool predict(uint64_t planetID, PredictionContext &context) {
+    computeIndicesAndTags(planetID, context);
+
+    // The table with the longest history that holds the tag provides the
+    // prediction. A newly allocated (weak) provider defers to the next table
+    // holding the tag (the alternate).
+    bool final_prediction = false;
+    bool isProviderWeak = false;
+    context.provider = -1;
+    context.providerWay = 0;
+    context.alternate = -1;
+    forEachTableReversedUntil([&](auto table) {
+      constexpr int i = decltype(table)::value;
+      int way = findWay(i, context.indices[i], context.tags[i]);
+      if (way < 0) return false;
+      uint16_t entry = entryAt(i, context.indices[i] + way);
+      bool prediction = counterOf(entry) >= (MAX_COUNTER + 1) / 2;
+      if (context.provider >= 0) {
+        context.alternate = i;
+        context.alternatePrediction = prediction;
+        if (isProviderWeak) final_prediction = prediction;
+        return true;
+      }
+      context.provider = i;
+      context.providerWay = way;
+      context.providerPrediction = prediction;
+      final_prediction = prediction;
+      isProviderWeak = isWeak(counterOf(entry));
+      return !isProviderWeak && USEFUL_BITS == 0;
+    });
+    context.prediction = final_prediction;
 
     return final_prediction;
   }
 
   // Update the predictor with the actual outcome of time-of-day
   void update(uint64_t planetID, bool outcome) {
-    // Compute tag and index for each table
-    uint64_t tags[NUM_HISTORY_TABLES];
-    uint64_t indices[NUM_HISTORY_TABLES];
-
-    for (int table_num = 0; table_num < NUM_HISTORY_TABLES; table_num++) {
-      int tableSize = MAX_HISTORY_TABLE_SIZE >> table_num;
-      BIT_MASK(uint64_t, TAG_LENGTH);
-      indices[table_num] =
-          (planetID ^
-           (ghist &
-            ((table_num > 0) ? BIT_MASK(uint64_t, (1 << table_num)) : 0))) %
-          tableSize;
-      tags[table_num] =
-          (planetID ^
-           (ghist &
-            ((table_num > 0) ? BIT_MASK(uint64_t, (1 << table_num)) : 0))) &
-          BIT_MASK(uint64_t, TAG_LENGTH);
-    }
-
-    // Update the recently seen history accumulator
-    ghist = (ghist << 1) | (outcome ? 1 : 0);
+    // Indices and tags are normally left by predict() for the same planet
+    if (planetID != lastContext.planetID) {
+      computeIndicesAndTags(planetID, lastContext);
+    }
+    update(lastContext, outcome);
+  }
 
+  void update(const PredictionContext &context, bool outcome) {
     // Update the tables
     int i = 0;  // a number of a table to update
-    if (num_of_table_given_prev_prediction >= 0) {
-      if (prev_prediction == outcome) {  // correct prediction was made
-        i = num_of_table_given_prev_prediction;
-        // increment counter
-        if (outcome && (tables[i][indices[i]].counter < MAX_CONFIDENCE)) {
-          tables[i][indices[i]].counter++;
-        }
-        // decrement counter
-        else if (!outcome && (tables[i][indices[i]].counter > 0)) {
-          tables[i][indices[i]].counter--;
-        }
-      } else {  // incorrect prediction was made
-        if (num_of_table_given_prev_prediction <
-            NUM_HISTORY_TABLES - 1) {  // allocate to next table
-          i = num_of_table_given_prev_prediction + 1;
-          tables[i][indices[i]].tag = tags[i];
-          tables[i][indices[i]].counter = (outcome) ? 2 : 1;
-        } else {  // if already in the last table,
-                  // update the entry in the last table
-          i = num_of_table_given_prev_prediction;
-          // increment counter
-          if (outcome && tables[i][indices[i]].counter < MAX_CONFIDENCE) {
-            tables[i][indices[i]].counter++;
-          }
-          // decrement counter
-          else if (!outcome && (tables[i][indices[i]].counter > 0)) {
-            tables[i][indices[i]].counter--;
-          }
+    if (context.provider >= 0) {
+      i = context.provider;
+      uint16_t &entry = entryAt(i, context.indices[i] + context.providerWay);
+      updateCounter(entry, outcome);
+      if constexpr (USEFUL_BITS > 0) {
+        // The provider is useful if it is right where the alternate is wrong
+        if (context.alternate >= 0 &&
+            context.providerPrediction != context.alternatePrediction) {
+          updateUseful(entry, context.providerPrediction == outcome);
         }
       }
+      touch(i, context.indices[i], context.providerWay);
+      // incorrect prediction was made, allocate to a next table
+      if (context.prediction != outcome) {
+        allocate(context, i + 1, outcome);
+      }
     } else {  // was not found last time
               // allocate to the first table
-      int i = 0;
-      tables[i][indices[i]].tag = tags[i];
-      tables[i][indices[i]].counter = (outcome) ? 2 : 1;
+      allocate(context, 0, outcome);
     }
+
+    if constexpr (USEFUL_BITS > 0) {
+      if (++updatesSinceAging == Config::usefulAgingPeriod) {
+        updatesSinceAging = 0;
+        ageUsefulCounters();
+      }
+    }
+
+    // Update the recently seen history and the folded histories
+    updateHistory(outcome);
+  }
+
+  // Size of the history tables in bytes, including the replacement state of
+  // set-associative tables
+  static constexpr size_t getTableStorageSize() {
+    return (sizeof(uint16_t) + (ASSOCIATIVITY > 1 ? sizeof(uint8_t) : 0)) *
+           NUM_TABLES * TABLE_SIZE;
   }
 
  private:
-  // Data structure for a history table entry
-  struct TableEntry {
-    uint64_t tag;
-    int counter;
-  };
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  // Tag length of a table: linear from minTagLength to maxTagLength
+  static constexpr int tagLength(int table) {
+    if (NUM_TABLES == 1) return Config::minTagLength;
+    return Config::minTagLength +
+           (Config::maxTagLength - Config::minTagLength) * table /
+               (NUM_TABLES - 1);
+  }
+
+  // History length of a table: a geometric series from minHistoryLength
+  // (table 1) to maxHistoryLength (the last table). Table 0 uses no history.
+  static constexpr int historyLength(int table) {
+    if (table == 0) return 0;
+    if (NUM_TABLES <= 2) return Config::minHistoryLength;
+    double ratio = spaceship_computer_detail::root(
+        (double)Config::maxHistoryLength / Config::minHistoryLength,
+        NUM_TABLES - 2);
+    return (int)(Config::minHistoryLength *
+                     spaceship_computer_detail::power(ratio, table - 1) +
+                 0.5);
+  }
+
+  // The history buffer is a power of two, so it wraps around with a mask
+  static constexpr int HISTORY_SIZE =
+      spaceship_computer_detail::nextPowerOfTwo(Config::maxHistoryLength + 1);
+  static constexpr size_t HISTORY_MASK = HISTORY_SIZE - 1;
+
+  // Accessors of packed table entries. New entries are not useful.
+  static uint16_t packEntry(uint16_t tag, int counter) {
+    return (uint16_t)((tag << TAG_SHIFT) | counter);
+  }
+  static uint16_t tagOf(uint16_t entry) { return entry >> TAG_SHIFT; }
+  static int counterOf(uint16_t entry) { return entry & MAX_COUNTER; }
+  static int usefulOf(uint16_t entry) {
+    return (entry >> COUNTER_BITS) & MAX_USEFUL;
+  }
+
+  static void updateUseful(uint16_t &entry, bool isUseful) {
+    if (isUseful && usefulOf(entry) < MAX_USEFUL) {
+      entry += 1 << COUNTER_BITS;
+    } else if (!isUseful && usefulOf(entry) > 0) {
+      entry -= 1 << COUNTER_BITS;
+    }
+  }
+
+  // Counters of newly allocated entries
+  static int newCounter(bool outcome) {
+    return (MAX_COUNTER + 1) / 2 - (outcome ? 0 : 1);
+  }
+  static bool isWeak(int counter) {
+    return counter == (MAX_COUNTER + 1) / 2 ||
+           counter == (MAX_COUNTER + 1) / 2 - 1;
+  }
+
+  template <typename F>
+  static void forEachTable(F &&f) {
+    spaceship_computer_detail::forEach(
+        f, make_integer_sequence<int, NUM_TABLES>());
+  }
+
+  template <typename F>
+  static void forEachTableReversedUntil(F &&f) {
+    spaceship_computer_detail::forEachReversedUntil<NUM_TABLES>(
+        f, make_integer_sequence<int, NUM_TABLES>());
+  }
+
+  // The most recent Length outcomes folded into Width bits. Folding is a
+  // circular shift register: every outcome shifts the new bit in and cancels
+  // the bit leaving the history, so the folded value is updated in constant
+  // time instead of being recomputed from the full history.
+  template <int Length, int Width>
+  static void updateFoldedHistory(uint64_t &value, bool newBit,
+                                  bool outgoingBit) {
+    if constexpr (Width > 0) {
+      value = (value << 1) | (newBit ? 1 : 0);
+      value ^= (uint64_t)(outgoingBit ? 1 : 0) << (Length % Width);
+      value ^= value >> Width;
+      value &= BIT_MASK(uint64_t, Width);
+    }
+  }
+
+  // History tables, stored one after another in a single cache-line-aligned
+  // array of packed entries. The ways of a set are adjacent.
+  alignas(CACHE_LINE_SIZE) uint16_t entries[NUM_TABLES * TABLE_SIZE] = {};
+  // Number of updates of a set since every way was last used (saturating),
+  // only kept by set-associative tables
+  uint8_t ages[ASSOCIATIVITY > 1 ? NUM_TABLES * TABLE_SIZE : 1] = {};
 
-  int num_of_table_given_prev_prediction = -1;
-  bool prev_prediction = 0;
+  // Context of the calls without an explicit one
+  PredictionContext lastContext = {};
 
-  // History tables
-  vector<vector<TableEntry>> tables;
+  // History of recently seen outcomes (a circular buffer, the most recent
+  // outcome at historyHead) and its folded copies for every table
+  bitset<HISTORY_SIZE> history;
+  size_t historyHead = 0;
+  uint64_t foldedIndexHistories[NUM_TABLES] = {};
+  uint64_t foldedTagHistories[NUM_TABLES] = {};
+  uint64_t foldedTagHistories2[NUM_TABLES] = {};
+  // Number of updates since the useful counters were last aged
+  int updatesSinceAging = 0;
 
-  // Stores history of recently seen outcomes (as a shift register)
-  uint64_t ghist = 0;
+  uint16_t &entryAt(int table, uint32_t index) {
+    return entries[((size_t)table << LOG_TABLE_SIZE) + index];
+  }
 
-  // Initialize the history tables
-  void initializeTables() {
-    for (int table_num = 0; table_num < NUM_HISTORY_TABLES; table_num++) {
-      int tableSize = MAX_HISTORY_TABLE_SIZE >> table_num;
-      tables.push_back(vector<TableEntry>(tableSize));
-      for (int entry_num = 0; entry_num < tableSize; entry_num++) {
-        tables[table_num][entry_num].tag = 0;
-        tables[table_num][entry_num].counter = 0;
+  // Way of the set starting at `set` that holds `tag`, -1 if none does
+  int findWay(int table, uint32_t set, uint16_t tag) {
+    const uint16_t *ways = &entryAt(table, set);
+    if constexpr (ASSOCIATIVITY == 1) {
+      return tagOf(ways[0]) == tag ? 0 : -1;
+    }
+#ifdef __SSE2__
+    if constexpr (ASSOCIATIVITY == 4 || ASSOCIATIVITY == 8) {
+      __m128i packed = ASSOCIATIVITY == 8
+                           ? _mm_load_si128((const __m128i *)ways)
+                           : _mm_loadl_epi64((const __m128i *)ways);
+      __m128i tags = _mm_and_si128(
+          packed, _mm_set1_epi16((short)(uint16_t)~((1 << TAG_SHIFT) - 1)));
+      __m128i matches =
+          _mm_cmpeq_epi16(tags, _mm_set1_epi16((short)(tag << TAG_SHIFT)));
+      // Two mask bits per 16-bit way
+      unsigned mask = (unsigned)_mm_movemask_epi8(matches) &
+                      ((1u << (2 * ASSOCIATIVITY)) - 1);
+      return mask ? __builtin_ctz(mask) / 2 : -1;
+    }
+#endif
+#ifdef __AVX2__
+    if constexpr (ASSOCIATIVITY == 16) {
+      __m256i packed = _mm256_load_si256((const __m256i *)ways);
+      __m256i tags = _mm256_and_si256(
+          packed, _mm256_set1_epi16((short)(uint16_t)~((1 << TAG_SHIFT) - 1)));
+      __m256i matches = _mm256_cmpeq_epi16(
+          tags, _mm256_set1_epi16((short)(tag << TAG_SHIFT)));
+      unsigned mask = (unsigned)_mm256_movemask_epi8(matches);
+      return mask ? __builtin_ctz(mask) / 2 : -1;
+    }
+#endif
+    for (int way = 0; way < ASSOCIATIVITY; way++) {
+      if (tagOf(ways[way]) == tag) return way;
+    }
+    return -1;
+  }
+
+  // Distance of a counter from the weak states
+  static int strength(int counter) {
+    return counter >= (MAX_COUNTER + 1) / 2 ? counter - (MAX_COUNTER + 1) / 2
+                                            : (MAX_COUNTER + 1) / 2 - 1 -
+                                                  counter;
+  }
+
+  // Mark a way of a set as the most recently used one
+  void touch(int table, uint32_t set, int way) {
+    if constexpr (ASSOCIATIVITY > 1) {
+      uint8_t *setAges = &ages[((size_t)table << LOG_TABLE_SIZE) + set];
+      for (int w = 0; w < ASSOCIATIVITY; w++) {
+        if (setAges[w] < UINT8_MAX) setAges[w]++;
       }
+      setAges[way] = 0;
+    }
+  }
+
+  // Way of a set to be replaced by a new tag: the weakest and then the oldest
+  // among the non-useful ways, -1 if all ways are useful
+  int findVictim(int table, uint32_t set) {
+    if constexpr (ASSOCIATIVITY == 1) {
+      return usefulOf(entryAt(table, set)) == 0 ? 0 : -1;
+    }
+    const uint8_t *setAges = &ages[((size_t)table << LOG_TABLE_SIZE) + set];
+    int victim = -1;
+    int victimScore = INT_MAX;
+    for (int way = 0; way < ASSOCIATIVITY; way++) {
+      uint16_t entry = entryAt(table, set + way);
+      if (Config::isEmptyWayMarked && tagOf(entry) == EMPTY_TAG) return way;
+      if (usefulOf(entry) > 0) continue;
+      int score = strength(counterOf(entry)) * (UINT8_MAX + 1) +
+                  (UINT8_MAX - setAges[way]);
+      if (score < victimScore) {
+        victim = way;
+        victimScore = score;
+      }
+    }
+    return victim;
+  }
+
+  // Place the tag of the planet into the first table from firstTable on that
+  // has a non-useful entry in its set. Without useful counters this is always
+  // firstTable.
+  void allocate(const PredictionContext &context, int firstTable,
+                bool outcome) {
+    for (int table = firstTable; table < NUM_TABLES; table++) {
+      uint32_t set = context.indices[table];
+      int victim = findVictim(table, set);
+      if (victim >= 0) {
+        entryAt(table, set + victim) =
+            packEntry(context.tags[table], newCounter(outcome));
+        touch(table, set, victim);
+        return;
+      }
+    }
+    // Every candidate entry is useful: make them less useful, so the tag can
+    // be allocated next time
+    if constexpr (USEFUL_BITS > 0) {
+      for (int table = firstTable; table < NUM_TABLES; table++) {
+        for (int way = 0; way < ASSOCIATIVITY; way++) {
+          updateUseful(entryAt(table, context.indices[table] + way), false);
+        }
+      }
+    }
+  }
+
+  // Graceful aging: decrement every useful counter
+  void ageUsefulCounters() {
+    for (uint16_t &entry : entries) updateUseful(entry, false);
+  }
+
+  void computeIndicesAndTags(uint64_t planetID, PredictionContext &context) {
+    context.planetID = planetID;
+    forEachTable([&](auto table) {
+      constexpr int i = decltype(table)::value;
+      constexpr uint64_t tagMask = BIT_MASK(uint64_t, tagLength(i));
+      if constexpr (i == 0) {
+        // Table 0 uses the planet ID alone
+        context.indices[0] = (planetID & SET_MASK) * ASSOCIATIVITY;
+        if constexpr (Config::isTagAboveIndex) {
+          context.tags[0] = (planetID >> LOG_NUM_SETS) & tagMask;
+        } else {
+          context.tags[0] = planetID & tagMask;
+        }
+      } else {
+        context.indices[i] = ((planetID ^ (planetID >> LOG_NUM_SETS) ^
+                               foldedIndexHistories[i]) &
+                              SET_MASK) *
+                             ASSOCIATIVITY;
+        context.tags[i] = (planetID ^ foldedTagHistories[i] ^
+                           (foldedTagHistories2[i] << 1)) &
+                          tagMask;
+      }
+      if constexpr (Config::isEmptyWayMarked &&
+                    tagLength(i) == MAX_PACKED_TAG_LENGTH) {
+        if (context.tags[i] == EMPTY_TAG) context.tags[i] ^= 1;
+      }
+    });
+  }
+
+  static void updateCounter(uint16_t &entry, bool outcome) {
+    // increment counter
+    if (outcome && (counterOf(entry) < MAX_COUNTER)) {
+      entry++;
+    }
+    // decrement counter
+    else if (!outcome && (counterOf(entry) > 0)) {
+      entry--;
+    }
+  }
+
+  void updateHistory(bool outcome) {
+    if constexpr (NUM_TABLES > 1) {
+      historyHead = (historyHead - 1) & HISTORY_MASK;
+      history[historyHead] = outcome;
+      forEachTable([&](auto table) {
+        constexpr int i = decltype(table)::value;
+        if constexpr (i > 0) {
+          constexpr int length = historyLength(i);
+          constexpr int tagWidth = tagLength(i);
+          bool outgoingBit = history[(historyHead + length) & HISTORY_MASK];
+          updateFoldedHistory<length, LOG_NUM_SETS>(foldedIndexHistories[i],
+                                                    outcome, outgoingBit);
+          updateFoldedHistory<length, tagWidth>(foldedTagHistories[i], outcome,
+                                                outgoingBit);
+          updateFoldedHistory<length, tagWidth - 1>(foldedTagHistories2[i],
+                                                    outcome, outgoingBit);
+        }
+      });
     }
   }
 };
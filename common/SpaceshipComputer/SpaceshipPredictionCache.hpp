@@ -0,0 +1,146 @@
+/*
+ *   BSD LICENSE
+ *
+ *   (C) Copyright 2023 Huawei Technologies Research & Development (UK) Ltd
+ *   All rights reserved.
+ *   Prepared by Artemiy Margaritov <artemiy.margaritov@huawei.com>
+ */
+
+// Cache of the predictions of the spaceship computer.
+//
+// The spaceship computer is deterministic given the route, so its predictions
+// are computed once per route and configuration and stored as a bit column in
+// a cache directory. Later evaluations of the same route read the column
+// instead of running the spaceship computer. A cache file is named after a
+// hash of the route file, the configuration of the spaceship computer and
+// SPACESHIP_COMPUTER_VERSION, so editing the route or the predictor never
+// reuses stale predictions.
+//
+// File format: the magic "SPCC", the number of planets (uint64_t) and the
+// predictions packed into uint64_t words, planet i at bit i % 64 of word
+// i / 64.
+
+#pragma once
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Increment whenever a change of SpaceshipComputer changes its predictions
+// or the layout of the cache files changes
+const int SPACESHIP_COMPUTER_VERSION = 5;
+
+class SpaceshipPredictionCache {
+ public:
+  // An empty cacheDir disables the cache
+  SpaceshipPredictionCache(const std::string &cacheDir,
+                           const std::string &routeFile,
+                           const std::string &configName,
+                           uint64_t numberOfPlanets)
+      : numberOfPlanets(numberOfPlanets) {
+    if (cacheDir.empty()) return;
+    isEnabled = true;
+    char routeHash[17];
+    snprintf(routeHash, sizeof(routeHash), "%016llx",
+             (unsigned long long)hashFile(routeFile));
+    cacheFile = cacheDir + "/" + routeHash + "-" + configName + "-v" +
+                std::to_string(SPACESHIP_COMPUTER_VERSION) + ".bits";
+    isLoaded = load();
+    if (!isLoaded) {
+      predictions.assign((numberOfPlanets + 63) / 64, 0);
+    }
+  }
+
+  // True if the predictions were read from the cache, so the spaceship
+  // computer doesn't need to run
+  bool hasPredictions() const { return isLoaded; }
+
+  // Planets are numbered from 0 in the order of the route
+  bool getPrediction(uint64_t planetNumber) const {
+    if (planetNumber >= numberOfPlanets) return false;
+    return (predictions[planetNumber / 64] >> (planetNumber % 64)) & 1;
+  }
+
+  // Record the prediction of the spaceship computer for the next planet
+  void recordPrediction(uint64_t planetNumber, bool prediction) {
+    if (!isEnabled || isLoaded || planetNumber >= numberOfPlanets) return;
+    predictions[planetNumber / 64] |= (uint64_t)prediction
+                                      << (planetNumber % 64);
+    numberOfRecordedPlanets = planetNumber + 1;
+  }
+
+  // Write the recorded predictions if the whole route has been evaluated
+  void store() {
+    if (!isEnabled || isLoaded || numberOfRecordedPlanets != numberOfPlanets) {
+      return;
+    }
+    std::string cacheDir = cacheFile.substr(0, cacheFile.rfind('/'));
+    if (mkdir(cacheDir.c_str(), 0755) != 0 && errno != EEXIST) {
+      std::cerr << "Can't create the spaceship computer cache directory "
+                << cacheDir << std::endl;
+      return;
+    }
+    // Write to a temporary file first, so concurrent evaluations never read
+    // a partially written column
+    std::string tmpFile = cacheFile + ".tmp" + std::to_string(getpid());
+    std::ofstream file(tmpFile, std::ios::binary);
+    file.write(kMagic, sizeof(kMagic));
+    file.write((const char *)&numberOfPlanets, sizeof(numberOfPlanets));
+    file.write((const char *)predictions.data(),
+               predictions.size() * sizeof(uint64_t));
+    file.close();
+    if (!file || rename(tmpFile.c_str(), cacheFile.c_str()) != 0) {
+      std::cerr << "Can't write the spaceship computer cache file "
+                << cacheFile << std::endl;
+      remove(tmpFile.c_str());
+    }
+  }
+
+ private:
+  static constexpr char kMagic[4] = {'S', 'P', 'C', 'C'};
+
+  bool isEnabled = false;
+  bool isLoaded = false;
+  std::string cacheFile;
+  uint64_t numberOfPlanets;
+  uint64_t numberOfRecordedPlanets = 0;
+  std::vector<uint64_t> predictions;
+
+  // 64-bit FNV-1a hash of the contents of a file
+  static uint64_t hashFile(const std::string &filename) {
+    std::ifstream file(filename, std::ios::binary);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    char buffer[1 << 16];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+      for (std::streamsize i = 0; i < file.gcount(); i++) {
+        hash = (hash ^ (unsigned char)buffer[i]) * 0x100000001b3ULL;
+      }
+    }
+    return hash;
+  }
+
+  bool load() {
+    std::ifstream file(cacheFile, std::ios::binary);
+    if (!file) return false;
+    char magic[sizeof(kMagic)];
+    uint64_t count = 0;
+    file.read(magic, sizeof(magic));
+    file.read((char *)&count, sizeof(count));
+    if (!file || std::string(magic, sizeof(magic)) !=
+                     std::string(kMagic, sizeof(kMagic)) ||
+        count != numberOfPlanets) {
+      return false;
+    }
+    predictions.resize((count + 63) / 64);
+    file.read((char *)predictions.data(),
+              predictions.size() * sizeof(uint64_t));
+    return (bool)file;
+  }
+};
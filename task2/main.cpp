@@ -9,32 +9,63 @@
 #include "CmdlineArgumentParser.hpp"
 #include "DynamicInstructionCounting/DynamicInstructionCounting_API.hpp"
 #include "PredictionAlgorithm/PredictionAlgorithm.hpp"
+#include "RoboPredictionContext.hpp"
 #include "Route.hpp"
 #include "SpaceshipComputer/SpaceshipComputer.hpp"
+#include "SpaceshipComputer/SpaceshipPredictionCache.hpp"
 
-int main(int argc, char **argv) {
-  // Parse command-line options
-  CmdlineOptions cmdline_opts;
-  if (!parseComdlineOptions(argc, argv, cmdline_opts)) {
-    std::cout << "Can't parse command-line arguments" << std::endl;
-    return 1;
-  }
+// Evaluate Robo's prediction algorithm on the route with the given spaceship
+// computer
+template <typename SpaceshipComputerType>
+int evaluateRoboPredictor(CmdlineOptions &cmdline_opts) {
   // Open a file with a route and initialize the route structure
   std::cout << "Loading Robo's route for evaluation from "
             << cmdline_opts.inFile << " file..." << std::endl;
   Route atlasRoute(cmdline_opts.inFile);
   // Create and initialize spaceshipComputer object
-  SpaceshipComputer spaceshipComputer;
+  SpaceshipComputerType spaceshipComputer;
+  // Predictions of the spaceship computer saved by a previous evaluation of
+  // the route, if any
+  SpaceshipPredictionCache spaceshipPredictionCache(
+      cmdline_opts.spaceshipCacheDir, cmdline_opts.inFile,
+      cmdline_opts.spaceshipComputer, atlasRoute.getTotalNumberOfPlanets());
   // Create and initialize roboPredictor object
   RoboPredictor roboPredictor;
 
   std::cout << "Starting evaluation of Robo's prediction algorithm... "
             << std::endl;
   PlanetInfo nextPlanet;
-  while (atlasRoute.readLineFromAtlasFile(nextPlanet)) {
-    // Ask Spaceship computer for help
-    bool spaceshipComputerPrediction =
-        spaceshipComputer.predict(nextPlanet.planetID);
+  while ((cmdline_opts.numberOfSampledPlanets <= 0 ||
+          atlasRoute.numberOfVisitedPlanets <
+              cmdline_opts.numberOfSampledPlanets) &&
+         atlasRoute.readLineFromAtlasFile(nextPlanet)) {
+    // Contexts carried from the predictions for this planet to the updates
+    typename SpaceshipComputerType::PredictionContext
+        spaceshipComputerContext{};
+    RoboPredictionContext<RoboPredictor> roboContext{};
+
+    // Position of the planet in the route (the route already counts it as
+    // visited)
+    uint64_t planetNumber = atlasRoute.numberOfVisitedPlanets - 1;
+
+    // Ask Spaceship computer for help. Its cost is not part of the metric;
+    // with --measure-spaceship-computer it is counted in a separate bank
+    bool spaceshipComputerPrediction;
+    if (spaceshipPredictionCache.hasPredictions()) {
+      spaceshipComputerPrediction =
+          spaceshipPredictionCache.getPrediction(planetNumber);
+    } else {
+      if (cmdline_opts.isSpaceshipComputerMeasured) {
+        enableDynamicInstructionCountingInBank(SPACESHIP_COMPUTER_COUNTER_BANK);
+      }
+      spaceshipComputerPrediction = spaceshipComputer.predict(
+          nextPlanet.planetID, spaceshipComputerContext);
+      if (cmdline_opts.isSpaceshipComputerMeasured) {
+        disableDynamicInstructionCounting();
+      }
+      spaceshipPredictionCache.recordPrediction(planetNumber,
+                                                spaceshipComputerPrediction);
+    }
 
     // Dynamic instruction counting is required to check if the compute cost
     // limit was not violated while making predictions and updating Robo's
@@ -44,14 +75,16 @@ int main(int argc, char **argv) {
     //----------------------------------------------------------------------------------------
     //---------The functions called below are to be implemented by contestants-----
     // Make a prediction of time-of-day on the next planet
-    bool prediction = roboPredictor.predictTimeOfDayOnNextPlanet(
-        nextPlanet.planetID, spaceshipComputerPrediction,
-        nextPlanet.planetGroupTag);
+    bool prediction = predictTimeOfDayWithContext(
+        roboPredictor, roboContext, nextPlanet.planetID,
+        spaceshipComputerPrediction, nextPlanet.planetGroupTag);
 
+    selectCounterBank(ROBO_OBSERVE_COUNTER_BANK);
     // Arrive on the planet and learn the actual time-of-day there.
     // Record the patterns in Robo's internal memory
-    roboPredictor.observeAndRecordTimeofdayOnNextPlanet(nextPlanet.planetID,
-                                                        nextPlanet.timeOfDay);
+    observeAndRecordTimeofdayWithContext(roboPredictor, roboContext,
+                                         nextPlanet.planetID,
+                                         nextPlanet.timeOfDay);
     //---------End of the section with the functions that are to be implemented by contestants
     //----------------------------------------------------------------------------------------
 
@@ -59,7 +92,15 @@ int main(int argc, char **argv) {
     disableDynamicInstructionCounting();
     // Notify the spaceship computer about the actual time-of-day outcome, so it
     // can update it's internal memory
-    spaceshipComputer.update(nextPlanet.planetID, nextPlanet.timeOfDay);
+    if (!spaceshipPredictionCache.hasPredictions()) {
+      if (cmdline_opts.isSpaceshipComputerMeasured) {
+        enableDynamicInstructionCountingInBank(SPACESHIP_COMPUTER_COUNTER_BANK);
+      }
+      spaceshipComputer.update(spaceshipComputerContext, nextPlanet.timeOfDay);
+      if (cmdline_opts.isSpaceshipComputerMeasured) {
+        disableDynamicInstructionCounting();
+      }
+    }
 
     // Update accuracy statistics
     atlasRoute.updatePredictionAccuracyStatistics(prediction,
@@ -76,8 +117,48 @@ int main(int argc, char **argv) {
       atlasRoute.displayProgressBar();
     }
   }
+  if (cmdline_opts.numberOfSampledPlanets > 0) {
+    // Only a prefix of the route was evaluated
+    std::cout << std::endl
+              << "Prediction accuracy on the sample of "
+              << atlasRoute.numberOfVisitedPlanets << " planets "
+              << std::setprecision(4)
+              << (float)atlasRoute.numberOfCorrectPredictions /
+                     atlasRoute.numberOfVisitedPlanets * 100
+              << "%" << std::endl;
+    printInstructionCountingStatistics(atlasRoute.numberOfVisitedPlanets);
+    printExtrapolatedComputationalCost(atlasRoute.numberOfVisitedPlanets,
+                                       atlasRoute.getTotalNumberOfPlanets());
+    return 0;
+  }
+  spaceshipPredictionCache.store();
   // Print total prediction accuracy
   atlasRoute.printFinalPredictionAccuracy();
   // Print computational cost
   printInstructionCountingStatistics(atlasRoute.getTotalNumberOfPlanets());
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  // Parse command-line options
+  CmdlineOptions cmdline_opts;
+  if (!parseComdlineOptions(argc, argv, cmdline_opts)) {
+    std::cout << "Can't parse command-line arguments" << std::endl;
+    return 1;
+  }
+  // Every configuration of the spaceship computer is a separate instantiation
+  if (cmdline_opts.spaceshipComputer == "tage") {
+    return evaluateRoboPredictor<
+        SpaceshipComputer<TageSpaceshipComputerConfig>>(cmdline_opts);
+  }
+  if (cmdline_opts.spaceshipComputer == "tage-4way") {
+    return evaluateRoboPredictor<
+        SpaceshipComputer<Tage4WaySpaceshipComputerConfig>>(cmdline_opts);
+  }
+  if (cmdline_opts.spaceshipComputer == "tage-8way") {
+    return evaluateRoboPredictor<
+        SpaceshipComputer<Tage8WaySpaceshipComputerConfig>>(cmdline_opts);
+  }
+  return evaluateRoboPredictor<
+      SpaceshipComputer<OriginalSpaceshipComputerConfig>>(cmdline_opts);
 }